@@ -0,0 +1,105 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file AsioReactorBackend.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the AsioReactorBackend class.
+ */
+#ifndef DPTCPP_CONFIG_ASIOREACTORBACKEND_H
+#define DPTCPP_CONFIG_ASIOREACTORBACKEND_H
+
+#include <boost/asio.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+
+#include "ReactorBackend.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief A ReactorBackend running a boost::asio::io_service on every thread.
+		 *
+		 * Lanes ready to run wait in a queue per priority class, shared by the threads; every
+		 * lane scheduled posts a handler to the io_service, which runs the lane of the highest
+		 * class waiting when it is called.
+		 *
+		 * Scheduling is not lock-free: the poster finding a lane idle takes readyLock and posts
+		 * the handler, which takes the lock of the io_service and allocates the handler unless
+		 * the poster is a thread of the backend. Posters finding the lane already scheduled do
+		 * neither.
+		 */
+		class AsioReactorBackend : public ReactorBackend {
+			private:
+				/**
+				 * \internal
+				 * \brief The reactor object.
+				 */
+				boost::asio::io_service reactor;
+
+				/**
+				 * \internal
+				 * \brief The mutex guarding ready.
+				 */
+				boost::mutex readyLock;
+
+				/**
+				 * \internal
+				 * \brief The lanes waiting for a thread, per class.
+				 */
+				std::deque<Lane*> ready[Priority::Count];
+
+				/**
+				 * \internal
+				 * \brief A work object keeping the reactor alive until shutdown.
+				 */
+				boost::asio::io_service::work* keeper;
+
+				/**
+				 * \internal
+				 * Queues a lane and posts a handler for it.
+				 */
+				void schedule(Lane* lane);
+
+				/**
+				 * \internal
+				 * The handler posted for every lane scheduled: runs the lane of the highest class waiting.
+				 */
+				void pump();
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				AsioReactorBackend(const AsioReactorBackend& other) = delete;
+
+				/**
+				 * Constructs a backend.
+				 * \param [in] threads The number of threads which will call run().
+				 * \param [in] metrics The metrics to record the functions in. Must outlive the backend.
+				 */
+				AsioReactorBackend(unsigned threads, ReactorMetrics& metrics);
+
+				~AsioReactorBackend();
+
+				void run();
+
+				void shutdown();
+		};
+	}
+}
+
+#endif
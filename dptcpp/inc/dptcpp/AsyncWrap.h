@@ -26,21 +26,83 @@
 
 #include <boost/function.hpp>
 
-/**
- * \brief Puts an asynchronous wrapper around the function refered by the parameter.
- *
- * This means that execution of the returned function will be delegated to
- * the PropertyReactor if it is running. (If it is not running, calling the
- * wrapper will result in undefined behaviour)
- *
- * \param [in] func The function to wrap asynchronously.
- * \return The asynchronous wrapper.
- */
-
+#include "ReactorBackend.h"
 
 namespace denprot {
 	namespace config {
+		class Reactor;
+
+		/**
+		 * Identifies the subscriber a connection belongs to, usually the address of the
+		 * observing object. Notifications of the same subscriber raised while a
+		 * NotificationBatch is open are merged into one. NULL means no identity.
+		 */
+		typedef const void* SubscriberId;
+
+		/**
+		 * \brief Delegates execution of a function to the PropertyReactor.
+		 *
+		 * If a NotificationBatch is open on the calling thread, the function is handed
+		 * to the batch instead, which may merge it into an earlier function of the same subscriber.
+		 *
+		 * Functions of the same subscriber and priority run in the order they were posted and
+		 * never concurrently; so do functions without a subscriber posted with the same key.
+		 * (See PropertyReactor::post(boost::function<void()>, const void*))
+		 * \param [in] func The function to run in the reactor.
+		 * \param [in] subscriber The subscriber the function belongs to.
+		 * \param [in] dropped Called instead of func if func gets merged or the reactor is not
+		 * started, so it will never run. May be empty.
+		 * \param [in] key The ordering key used if subscriber is NULL, usually the address of the
+		 * property raising the notification. Functions without a subscriber and a key keep the
+		 * order of the reactor.
+		 * \param [in] reactor The reactor to run the function in, NULL for the global one.
+		 * It must be kept alive until the function ran.
+		 * \param [in] priority The priority class of the function. (See Priority)
+		 * \param [in] source The identity of the connection, reported if the function is slow.
+		 * NULL for the ordering key. (See SlowCallback::source)
+		 */
+		void asyncPost(const boost::function<void()>& func, SubscriberId subscriber,
+		               const boost::function<void()>& dropped = boost::function<void()>(),
+		               const void* key = NULL, Reactor* reactor = NULL,
+		               Priority::Class priority = Priority::Normal, const void* source = NULL);
+
+		/**
+		 * \internal
+		 * Posts a notification to a reactor without throwing: if the reactor is not started, the
+		 * notification is dropped with a diagnostic and dropped is called instead, so the changed
+		 * signal goes on with its other subscribers.
+		 * \param [in] func The function to run in the reactor.
+		 * \param [in] dropped Called if func is not posted. May be empty.
+		 * \param [in] key The ordering key.
+		 * \param [in] reactor The reactor, NULL for the global one.
+		 * \param [in] priority The priority class of the function.
+		 * \param [in] source The identity of the connection, NULL for the key.
+		 */
+		void asyncDeliver(const boost::function<void()>& func, const boost::function<void()>& dropped,
+		                  const void* key, Reactor* reactor, Priority::Class priority, const void* source);
+
+		/**
+		 * \brief Puts an asynchronous wrapper around the function refered by the parameter.
+		 *
+		 * This means that execution of the returned function will be delegated to
+		 * the PropertyReactor if it is running. (If it is not running, the function is
+		 * dropped with a diagnostic)
+		 * If a NotificationBatch is open on the calling thread, the function is handed
+		 * to the batch instead.
+		 *
+		 * \param [in] func The function to wrap asynchronously.
+		 * \return The asynchronous wrapper.
+		 */
 		boost::function<void()> asyncWrap(boost::function<void()> func);
+
+		/**
+		 * \brief Puts an asynchronous wrapper around a function of a given subscriber.
+		 * (See asyncWrap(boost::function<void()>))
+		 * \param [in] func The function to wrap asynchronously.
+		 * \param [in] subscriber The subscriber the function belongs to.
+		 * \return The asynchronous wrapper.
+		 */
+		boost::function<void()> asyncWrap(boost::function<void()> func, SubscriberId subscriber);
 	}
 }
 #endif
@@ -0,0 +1,210 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file ChangeToken.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the ChangeToken and ChangeTracker classes.
+ */
+#ifndef DPTCPP_CONFIG_CHANGETOKEN_H
+#define DPTCPP_CONFIG_CHANGETOKEN_H
+
+#include <boost/intrusive_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <atomic>
+#include <vector>
+
+namespace denprot {
+	namespace config {
+		class NotificationBatch;
+
+		/**
+		 * \internal
+		 * \brief The shared state of a ChangeToken.
+		 *
+		 * Counts the holds on the token: one per asynchronous notification not run yet and one
+		 * for the ChangeTracker while it is open. The token resolves when the last hold is
+		 * settled. Every hold also keeps a reference to the state.
+		 */
+		class ChangeTokenState {
+			private:
+				std::atomic<unsigned long> holds;
+				std::atomic<unsigned> refs;
+				mutable boost::mutex lock;
+				mutable boost::condition_variable resolvedCond;
+				bool resolved;
+
+				/**
+				 * States holding on this one, settled when it resolves. (See attach)
+				 */
+				std::vector<ChangeTokenState*> dependents;
+			public:
+				ChangeTokenState();
+
+				/**
+				 * Takes a hold.
+				 */
+				void hold() {
+					refs.fetch_add(1, std::memory_order_relaxed);
+					holds.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				/**
+				 * Settles a hold taken by hold(), resolving the token if it was the last one.
+				 * The state may be destroyed by the call.
+				 */
+				void settle();
+
+				/**
+				 * Makes another state wait for this one: a hold is taken on it and settled when
+				 * this state resolves. Does nothing if this state is already resolved. The other
+				 * state must not wait for this one already, or neither resolves. If an exception
+				 * is thrown, no hold is taken.
+				 * \param [in] other The state to hold.
+				 */
+				void attach(ChangeTokenState* other);
+
+				/**
+				 * Getter for the resolution.
+				 * \return True if every hold was settled.
+				 */
+				bool isResolved() const;
+
+				/**
+				 * Blocks until every hold is settled.
+				 */
+				void wait() const;
+
+				friend void intrusive_ptr_add_ref(ChangeTokenState* state) {
+					state->refs.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				friend void intrusive_ptr_release(ChangeTokenState* state) {
+					if(state->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+						delete state;
+				}
+		};
+
+		/**
+		 * \brief Completion of the asynchronous notifications of a change.
+		 *
+		 * Returned by Property::setValueTracked and PropertyTransaction::commitTracked, or by
+		 * closing a ChangeTracker. The token is done once every asynchronous subscriber notified
+		 * by the change ran, in whichever reactor it was posted to, along with every function
+		 * posted to a reactor by the local subscribers of the change. A notification merged by a
+		 * NotificationBatch into the notification of another change is waited for as long as
+		 * that change is.
+		 *
+		 * Unlike PropertyReactor::sync, waiting for a token does not wait for unrelated
+		 * notifications, and it may be called while other threads keep posting.
+		 */
+		class ChangeToken {
+			private:
+				boost::intrusive_ptr<ChangeTokenState> state;
+			public:
+				/**
+				 * Constructs a token which is already done.
+				 */
+				ChangeToken() {
+				}
+
+				/**
+				 * \internal
+				 * Constructs a token of a state.
+				 */
+				explicit ChangeToken(const boost::intrusive_ptr<ChangeTokenState>& state) : state(state) {
+				}
+
+				/**
+				 * Getter for the completion of the change.
+				 * \return True if the notifications of the change ran.
+				 */
+				bool isDone() const {
+					return !state || state->isResolved();
+				}
+
+				/**
+				 * Blocks until the notifications of the change ran. Must not be called by a
+				 * subscriber notified by the change.
+				 */
+				void wait() const {
+					if(state)
+						state->wait();
+				}
+		};
+
+		/**
+		 * \brief Tracks the asynchronous notifications posted by the calling thread.
+		 *
+		 * While a tracker is open, every function posted to a reactor by the thread, directly or
+		 * through a NotificationBatch, holds the token of the tracker until it ran. Trackers may
+		 * be nested: the token of the outer tracker also waits for the token of the inner one.
+		 */
+		class ChangeTracker {
+			friend class NotificationBatch;
+			private:
+				/**
+				 * \internal
+				 * The state of the token, NULL once closed.
+				 */
+				boost::intrusive_ptr<ChangeTokenState> state;
+
+				/**
+				 * \internal
+				 * The tracker open when this one was opened.
+				 */
+				ChangeTokenState* previous;
+
+				/**
+				 * \internal
+				 * Replaces the state the functions posted by the calling thread are tracked by.
+				 * \return The state replaced.
+				 */
+				static ChangeTokenState* exchange(ChangeTokenState* state);
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				ChangeTracker(const ChangeTracker& other) = delete;
+
+				/**
+				 * Opens a tracker on the calling thread.
+				 */
+				ChangeTracker();
+
+				/**
+				 * Closes the tracker if it was not closed yet.
+				 */
+				~ChangeTracker();
+
+				/**
+				 * Getter for the state the functions posted by the calling thread are tracked by.
+				 * \return The state of the innermost open tracker of the calling thread, or NULL.
+				 */
+				static ChangeTokenState* current();
+
+				/**
+				 * Stops tracking. Trackers must be closed in the reverse order of opening.
+				 * \return The token of the functions posted while the tracker was open.
+				 */
+				ChangeToken close();
+		};
+	}
+}
+
+#endif
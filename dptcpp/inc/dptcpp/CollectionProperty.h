@@ -0,0 +1,683 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file CollectionProperty.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * File declaring the CollectionProperty template class and its editors.
+ */
+#ifndef DPTCPP_CONFIG_COLLECTIONPROPERTY_H
+#define DPTCPP_CONFIG_COLLECTIONPROPERTY_H
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <glibmm.h>
+#include <type_traits>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+#include "PropertyReadOnly.h"
+#include "PropertyCompare.h"
+#include "AsyncWrap.h"
+#include "Exception.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * The kinds of containers a CollectionProperty can hold.
+		 */
+		enum CollectionKind {
+			/**
+			 * Containers indexed by position, like std::vector. Keys are indices.
+			 */
+			CollectionSequence,
+
+			/**
+			 * Containers of unique keys, like std::set. The value of a key is the key itself.
+			 */
+			CollectionSet,
+
+			/**
+			 * Containers mapping keys to values, like std::map.
+			 */
+			CollectionMap
+		};
+
+		/**
+		 * \internal
+		 * Detects the kind of a container from its member types.
+		 */
+		template<class C>
+		class CollectionKindOf {
+			private:
+				template<class U>
+				static std::true_type hasMapped(typename U::mapped_type*);
+
+				template<class U>
+				static std::false_type hasMapped(...);
+
+				template<class U>
+				static std::true_type hasKey(typename U::key_type*);
+
+				template<class U>
+				static std::false_type hasKey(...);
+			public:
+				static const CollectionKind value = decltype(hasMapped<C>(0))::value ? CollectionMap :
+				  decltype(hasKey<C>(0))::value ? CollectionSet : CollectionSequence;
+		};
+
+		/**
+		 * \internal
+		 * The key and value types of the changes of a container.
+		 */
+		template<class C, CollectionKind Kind = CollectionKindOf<C>::value>
+		struct CollectionKeys {
+			typedef std::size_t Key;
+			typedef typename C::value_type Value;
+		};
+
+		template<class C>
+		struct CollectionKeys<C, CollectionSet> {
+			typedef typename C::key_type Key;
+			typedef typename C::key_type Value;
+		};
+
+		template<class C>
+		struct CollectionKeys<C, CollectionMap> {
+			typedef typename C::key_type Key;
+			typedef typename C::mapped_type Value;
+		};
+
+		/**
+		 * \brief A change of a single element of a CollectionProperty.
+		 */
+		template<class C>
+		struct CollectionChange {
+			typedef typename CollectionKeys<C>::Key Key;
+			typedef typename CollectionKeys<C>::Value Value;
+
+			/**
+			 * What happened to the element.
+			 */
+			enum Kind {
+				Added,
+				Removed,
+				Updated
+			};
+
+			/**
+			 * What happened to the element.
+			 */
+			Kind kind;
+
+			/**
+			 * The key of the element. For sequences this is the index at the time of the change.
+			 */
+			Key key;
+
+			/**
+			 * The new value of an added or updated element, the old value of a removed one.
+			 */
+			Value value;
+
+			CollectionChange(Kind kind, const Key& key, const Value& value) : kind(kind), key(key), value(value) {
+			}
+		};
+
+		/**
+		 * \brief The changes made by one edit of a CollectionProperty.
+		 *
+		 * The changes are listed in the order they were made. Applying them in this order to a
+		 * copy of the previous value gives the new value; for sequences this matters, as inserting
+		 * or erasing an element shifts the indices of the elements after it.
+		 */
+		template<class C>
+		struct CollectionDelta {
+			/**
+			 * The changes, in order.
+			 */
+			std::vector<CollectionChange<C>> changes;
+
+			/**
+			 * The version of the property after the edit. (See PropertyCoreBase::getVersion)
+			 */
+			unsigned long version;
+
+			CollectionDelta() : version(0) {
+			}
+		};
+
+		/**
+		 * \brief Edits a container, recording every change made.
+		 *
+		 * An editor is handed to the function given to CollectionProperty::edit(). It works on
+		 * the new value of the property, which is published only when the function returns.
+		 * This is the editor of sequences; the editors of sets and maps are specialized below.
+		 */
+		template<class C, CollectionKind Kind = CollectionKindOf<C>::value>
+		class CollectionEditor {
+			public:
+				typedef CollectionChange<C> Change;
+				typedef typename Change::Key Key;
+				typedef typename Change::Value Value;
+			private:
+				/**
+				 * \internal
+				 * The container edited.
+				 */
+				C& target;
+
+				/**
+				 * \internal
+				 * The changes made so far.
+				 */
+				std::vector<Change>& changes;
+
+				/**
+				 * \internal
+				 * Throws if an index does not refer to an element.
+				 */
+				void check(std::size_t index) const {
+					if(index >= target.size())
+						throw Exception("CollectionProperty index out of range",CodePos);
+				}
+			public:
+				CollectionEditor(C& target, std::vector<Change>& changes) : target(target), changes(changes) {
+				}
+
+				/**
+				 * Getter for the container being edited.
+				 * \return The container with the changes made so far.
+				 */
+				const C& get() const {
+					return target;
+				}
+
+				/**
+				 * Inserts an element.
+				 * \param [in] index The index of the new element. It may be the size of the container.
+				 * \param [in] value The value of the new element.
+				 * \throw Exception If index is greater than the size of the container.
+				 */
+				void insert(std::size_t index, const Value& value) {
+					if(index > target.size())
+						throw Exception("CollectionProperty index out of range",CodePos);
+					target.insert(std::next(target.begin(), index), value);
+					changes.push_back(Change(Change::Added, index, value));
+				}
+
+				/**
+				 * Appends an element.
+				 * \param [in] value The value of the new element.
+				 */
+				void pushBack(const Value& value) {
+					insert(target.size(), value);
+				}
+
+				/**
+				 * Changes the value of an element.
+				 * \param [in] index The index of the element.
+				 * \param [in] value The new value of the element.
+				 * \return True if the value changed. (See PropertyCompare)
+				 * \throw Exception If there is no element with the given index.
+				 */
+				bool assign(std::size_t index, const Value& value) {
+					check(index);
+					Value& element = *std::next(target.begin(), index);
+					if(propertyEqual(element, value))
+						return false;
+					element = value;
+					changes.push_back(Change(Change::Updated, index, value));
+					return true;
+				}
+
+				/**
+				 * Removes an element.
+				 * \param [in] index The index of the element.
+				 * \throw Exception If there is no element with the given index.
+				 */
+				void erase(std::size_t index) {
+					check(index);
+					auto it = std::next(target.begin(), index);
+					changes.push_back(Change(Change::Removed, index, *it));
+					target.erase(it);
+				}
+
+				/**
+				 * Removes the last element.
+				 * \throw Exception If the container is empty.
+				 */
+				void popBack() {
+					erase(target.size() - 1);
+				}
+
+				/**
+				 * Removes every element, from the last to the first.
+				 */
+				void clear() {
+					while(!target.empty())
+						popBack();
+				}
+
+				/**
+				 * Replaces the whole container, recording the elements which differ.
+				 * \param [in] other The new content.
+				 */
+				void replace(const C& other) {
+					std::size_t common = std::min(target.size(), other.size());
+					auto src = other.begin();
+					for(std::size_t i = 0; i < common; ++i, ++src)
+						assign(i, *src);
+					while(target.size() > other.size())
+						popBack();
+					for(; src != other.end(); ++src)
+						pushBack(*src);
+				}
+		};
+
+		/**
+		 * \brief Edits a set, recording every change made. (See CollectionEditor)
+		 */
+		template<class C>
+		class CollectionEditor<C, CollectionSet> {
+			public:
+				typedef CollectionChange<C> Change;
+				typedef typename Change::Key Key;
+				typedef typename Change::Value Value;
+			private:
+				/**
+				 * \internal
+				 * The container edited.
+				 */
+				C& target;
+
+				/**
+				 * \internal
+				 * The changes made so far.
+				 */
+				std::vector<Change>& changes;
+			public:
+				CollectionEditor(C& target, std::vector<Change>& changes) : target(target), changes(changes) {
+				}
+
+				/**
+				 * Getter for the container being edited.
+				 * \return The container with the changes made so far.
+				 */
+				const C& get() const {
+					return target;
+				}
+
+				/**
+				 * Adds a key.
+				 * \param [in] key The key to add.
+				 * \return True if the key was not present yet.
+				 */
+				bool insert(const Key& key) {
+					if(!target.insert(key).second)
+						return false;
+					changes.push_back(Change(Change::Added, key, key));
+					return true;
+				}
+
+				/**
+				 * Removes a key.
+				 * \param [in] key The key to remove.
+				 * \return True if the key was present.
+				 */
+				bool erase(const Key& key) {
+					if(!target.erase(key))
+						return false;
+					changes.push_back(Change(Change::Removed, key, key));
+					return true;
+				}
+
+				/**
+				 * Removes every key.
+				 */
+				void clear() {
+					for(auto it = target.begin(); it != target.end(); ++it)
+						changes.push_back(Change(Change::Removed, *it, *it));
+					target.clear();
+				}
+
+				/**
+				 * Replaces the whole set, recording the keys removed and added.
+				 * \param [in] other The new content.
+				 */
+				void replace(const C& other) {
+					for(auto it = target.begin(); it != target.end();) {
+						if(other.find(*it) == other.end()) {
+							changes.push_back(Change(Change::Removed, *it, *it));
+							it = target.erase(it);
+						} else {
+							++it;
+						}
+					}
+					for(auto it = other.begin(); it != other.end(); ++it)
+						insert(*it);
+				}
+		};
+
+		/**
+		 * \brief Edits a map, recording every change made. (See CollectionEditor)
+		 */
+		template<class C>
+		class CollectionEditor<C, CollectionMap> {
+			public:
+				typedef CollectionChange<C> Change;
+				typedef typename Change::Key Key;
+				typedef typename Change::Value Value;
+			private:
+				/**
+				 * \internal
+				 * The container edited.
+				 */
+				C& target;
+
+				/**
+				 * \internal
+				 * The changes made so far.
+				 */
+				std::vector<Change>& changes;
+			public:
+				CollectionEditor(C& target, std::vector<Change>& changes) : target(target), changes(changes) {
+				}
+
+				/**
+				 * Getter for the container being edited.
+				 * \return The container with the changes made so far.
+				 */
+				const C& get() const {
+					return target;
+				}
+
+				/**
+				 * Adds a key unless it is present already.
+				 * \param [in] key The key to add.
+				 * \param [in] value The value of the key.
+				 * \return True if the key was not present yet.
+				 */
+				bool insert(const Key& key, const Value& value) {
+					if(!target.insert(typename C::value_type(key, value)).second)
+						return false;
+					changes.push_back(Change(Change::Added, key, value));
+					return true;
+				}
+
+				/**
+				 * Sets the value of a key, adding the key if it is not present.
+				 * \param [in] key The key.
+				 * \param [in] value The new value of the key.
+				 * \return True if the map changed. (See PropertyCompare)
+				 */
+				bool assign(const Key& key, const Value& value) {
+					auto it = target.find(key);
+					if(it == target.end())
+						return insert(key, value);
+					if(propertyEqual(it->second, value))
+						return false;
+					it->second = value;
+					changes.push_back(Change(Change::Updated, key, value));
+					return true;
+				}
+
+				/**
+				 * Removes a key.
+				 * \param [in] key The key to remove.
+				 * \return True if the key was present.
+				 */
+				bool erase(const Key& key) {
+					auto it = target.find(key);
+					if(it == target.end())
+						return false;
+					changes.push_back(Change(Change::Removed, key, it->second));
+					target.erase(it);
+					return true;
+				}
+
+				/**
+				 * Removes every key.
+				 */
+				void clear() {
+					for(auto it = target.begin(); it != target.end(); ++it)
+						changes.push_back(Change(Change::Removed, it->first, it->second));
+					target.clear();
+				}
+
+				/**
+				 * Replaces the whole map, recording the keys removed, added and updated.
+				 * \param [in] other The new content.
+				 */
+				void replace(const C& other) {
+					for(auto it = target.begin(); it != target.end();) {
+						if(other.find(it->first) == other.end()) {
+							changes.push_back(Change(Change::Removed, it->first, it->second));
+							it = target.erase(it);
+						} else {
+							++it;
+						}
+					}
+					for(auto it = other.begin(); it != other.end(); ++it)
+						assign(it->first, it->second);
+				}
+		};
+
+/**
+ * \brief A property holding a container, notifying its subscribers of the elements changed.
+ *
+ * The container is only changed through edits (see edit(), CollectionEditor), each of which
+ * produces a CollectionDelta listing the elements added, removed and updated. Subscribers
+ * connected with a delta function receive the delta of every edit, in order, so they can
+ * keep their own state up to date with work proportional to the change instead of the size
+ * of the container. Subscribers connected with the usual functions are notified as for any
+ * other property, and readers get immutable snapshots as usual.
+ *
+ * Every edit copies the container once, since snapshots handed out earlier must stay
+ * unchanged; edits with several changes should be batched with edit(). Edits are serialized
+ * and their notifications are made in the same order. Delta subscribers are never merged or
+ * coalesced. Local delta subscribers run while the edit is being published, so they must not
+ * edit the same property.
+ *
+ * \code
+ * CollectionProperty<std::map<Glib::ustring, int>> routes("routes");
+ * routes.connect(boost::function<void(const CollectionDelta<std::map<Glib::ustring, int>>&)>(apply));
+ * routes.assign("10.0.0.0/8", 1);
+ * routes.edit([](CollectionEditor<std::map<Glib::ustring, int>>& e) { e.erase("a"); e.assign("b", 2); });
+ * \endcode
+ */
+template<class C>
+class CollectionProperty : public PropertyReadOnly<C> {
+	public:
+		typedef CollectionEditor<C> Editor;
+		typedef CollectionDelta<C> Delta;
+		typedef CollectionChange<C> Change;
+		typedef typename Change::Key Key;
+		typedef typename Change::Value Value;
+
+		using PropertyReadOnly<C>::connect;
+		using PropertyReadOnly<C>::connectLocal;
+	private:
+		/**
+		 * \internal
+		 * State shared by the copies of a CollectionProperty.
+		 */
+		struct Channel {
+			/**
+			 * The mutex serializing edits together with their notifications.
+			 */
+			boost::mutex lock;
+
+			/**
+			 * The delta being published, read by the delta subscribers during the notification.
+			 */
+			boost::shared_ptr<const Delta> current;
+		};
+
+		/**
+		 * \internal
+		 * Clears the delta being published even if a subscriber throws.
+		 */
+		struct Publication {
+			Channel* channel;
+			~Publication() {
+				channel->current.reset();
+			}
+		};
+
+		/**
+		 * \internal
+		 * The shared state.
+		 */
+		boost::shared_ptr<Channel> channel;
+	public:
+		/**
+		 * \brief Constructs a collection property.
+		 * \param [in] name The name of the property.
+		 * \param [in] value The initial content.
+		 */
+		explicit CollectionProperty(const Glib::ustring& name, const C& value = C()) :
+			PropertyReadOnly<C>(typename PropertyReadOnly<C>::PropertyCoreDyn(new PropertyCore<C>(name, value))),
+			channel(boost::make_shared<Channel>()) {
+		}
+
+		/**
+		 * \brief Constructs a collection property, taking over the initial content.
+		 * \param [in] name The name of the property.
+		 * \param [in] value The initial content.
+		 */
+		CollectionProperty(const Glib::ustring& name, C&& value) :
+			PropertyReadOnly<C>(typename PropertyReadOnly<C>::PropertyCoreDyn(new PropertyCore<C>(name, std::move(value)))),
+			channel(boost::make_shared<Channel>()) {
+		}
+
+		/**
+		 * Edits the container. The changes made through the editor are published atomically
+		 * when fn returns, and notified as one delta. If fn throws, nothing is changed.
+		 * \param [in] fn The function making the changes, called with a CollectionEditor.
+		 * \return True if anything changed.
+		 */
+		template<class Fn>
+		bool edit(Fn fn) {
+			boost::lock_guard<boost::mutex> lck(channel->lock);
+			boost::shared_ptr<Delta> delta = boost::make_shared<Delta>();
+			bool changed = this->prop->editSilently([&fn, &delta](const C& current, C& next) {
+				Editor e(next, delta->changes);
+				fn(e);
+				return !delta->changes.empty();
+			});
+			if(!changed) {
+				this->prop->countSuppressed();
+				return false;
+			}
+			delta->version = this->prop->getVersion();
+			channel->current = delta;
+			Publication p = { channel.get() };
+			this->prop->notifyChanged();
+			return true;
+		}
+
+		/**
+		 * Inserts an element. (See CollectionEditor::insert)
+		 * \return True if anything changed.
+		 */
+		template<class... Args>
+		bool insert(const Args&... args) {
+			return edit([&](Editor& e) { e.insert(args...); });
+		}
+
+		/**
+		 * Appends an element to a sequence. (See CollectionEditor::pushBack)
+		 * \return True if anything changed.
+		 */
+		bool pushBack(const Value& value) {
+			return edit([&](Editor& e) { e.pushBack(value); });
+		}
+
+		/**
+		 * Sets the value of an element. (See CollectionEditor::assign)
+		 * \return True if anything changed.
+		 */
+		bool assign(const Key& key, const Value& value) {
+			return edit([&](Editor& e) { e.assign(key, value); });
+		}
+
+		/**
+		 * Removes an element. (See CollectionEditor::erase)
+		 * \return True if anything changed.
+		 */
+		bool erase(const Key& key) {
+			return edit([&](Editor& e) { e.erase(key); });
+		}
+
+		/**
+		 * Removes every element.
+		 * \return True if anything changed.
+		 */
+		bool clear() {
+			return edit([](Editor& e) { e.clear(); });
+		}
+
+		/**
+		 * Replaces the whole container, notifying only the elements which differ.
+		 * \param [in] value The new content.
+		 * \return True if anything changed.
+		 */
+		bool replace(const C& value) {
+			return edit([&](Editor& e) { e.replace(value); });
+		}
+
+		/**
+		 * Connects a delta subscriber. The subscriber runs in the reactor of the property and
+		 * receives the delta of every edit, in order.
+		 * \param [in] f The subscriber function.
+		 * \return A connection object to make possible disconnection and status checking.
+		 */
+		PropertyConnection connect(boost::function<void(const Delta&)> f) {
+			boost::shared_ptr<Channel> ch = channel;
+			boost::shared_ptr<Reactor> reactor = this->prop->getReactor();
+			return this->prop->connectLocal(boost::function<void()>([ch, f, reactor]() {
+				boost::shared_ptr<const Delta> delta = ch->current;
+				if(delta)
+					asyncPost([f, delta]() { f(*delta); }, NULL, boost::function<void()>(), ch.get(), reactor.get());
+			}));
+		}
+
+		/**
+		 * Connects a delta subscriber running on the thread editing the property.
+		 * \param [in] f The subscriber function.
+		 * \return A connection object to make possible disconnection and status checking.
+		 */
+		PropertyConnection connectLocal(boost::function<void(const Delta&)> f) {
+			boost::shared_ptr<Channel> ch = channel;
+			return this->prop->connectLocal(boost::function<void()>([ch, f]() {
+				if(ch->current)
+					f(*ch->current);
+			}));
+		}
+};
+
+}
+}
+
+#endif
@@ -25,8 +25,16 @@
 
 #include "ParseContext.h"
 #include "Property.h"
+#include "PropertyReadOnly.h"
+#include "DerivedProperty.h"
+#include "CollectionProperty.h"
+#include "Reactor.h"
 #include "PropertyReactor.h"
+#include "PropertyTransaction.h"
+#include "PropertyGraph.h"
 #include "PropertyParser.h"
+#include "PropertySchema.h"
+#include "SchemaParseContext.h"
 #include "PropertyCollection.h"
 #include "PropertySerializer.h"
 #include "ValueConvert.h"
@@ -0,0 +1,111 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file DerivedProperty.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * File declaring the DerivedProperty template class.
+ */
+#ifndef DPTCPP_CONFIG_DERIVEDPROPERTY_H
+#define DPTCPP_CONFIG_DERIVEDPROPERTY_H
+
+#include <boost/function.hpp>
+#include <glibmm.h>
+
+#include "PropertyReadOnly.h"
+#include "PropertyInterface.h"
+
+namespace denprot {
+	namespace config {
+
+/**
+ * \brief A read-only property whose value is computed from other properties.
+ *
+ * The value is computed lazily: a change of any input only marks the value dirty and notifies
+ * the subscribers of the DerivedProperty, and the compute function runs on the first read
+ * afterwards. Reading a clean value costs no more than reading a plain property.
+ *
+ * A DerivedProperty is a PropertyReadOnly, so it can be passed, copied and connected to like one;
+ * copies refer to the same derived core. T must be default constructible.
+ *
+ * \code
+ * Property<int> slots("slots", 4), slotSize("slotSize", 256);
+ * DerivedProperty<int> bufferBytes("bufferBytes",
+ *   [=]() { return slots.getValue() * slotSize.getValue(); }, slots, slotSize);
+ * \endcode
+ */
+template<typename T>
+class DerivedProperty : public PropertyReadOnly<T> {
+	private:
+		/**
+		 * \internal
+		 * Connects the inputs one by one.
+		 */
+		void addInputs() {
+		}
+
+		/**
+		 * \internal
+		 * Connects the inputs one by one.
+		 */
+		template<class Input, class... Inputs>
+		void addInputs(Input& input, Inputs&... inputs) {
+			addInput(input);
+			addInputs(inputs...);
+		}
+	public:
+		/**
+		 * \brief Constructs a derived property.
+		 * \param [in] name The name of the property.
+		 * \param [in] compute The function computing the value. It should read the inputs itself.
+		 * \param [in] inputs The properties the value depends on.
+		 */
+		template<class... Inputs>
+		DerivedProperty(const Glib::ustring& name, const boost::function<T()>& compute, Inputs&... inputs) :
+			PropertyReadOnly<T>(typename PropertyReadOnly<T>::PropertyCoreDyn(new PropertyCore<T>(name, T()))) {
+			this->prop->derive(compute);
+			addInputs(inputs...);
+		}
+
+		/**
+		 * Makes the value depend on one more property.
+		 * \param [in] input The property the value depends on.
+		 */
+		void addInput(PropertyInterface& input) {
+			this->prop->addInput(input);
+		}
+
+		/**
+		 * Marks the value dirty and notifies the subscribers, as if an input had changed.
+		 */
+		void invalidate() {
+			this->prop->invalidate();
+		}
+
+		/**
+		 * Shows whether the value will be recomputed on the next read.
+		 * \return True if any input changed since the value was computed last.
+		 */
+		bool isDirty() const {
+			return this->prop->isDirty();
+		}
+};
+
+}
+}
+
+#endif
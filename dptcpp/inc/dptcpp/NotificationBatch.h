@@ -0,0 +1,195 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file NotificationBatch.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the NotificationBatch class.
+ */
+#ifndef DPTCPP_CONFIG_NOTIFICATIONBATCH_H
+#define DPTCPP_CONFIG_NOTIFICATIONBATCH_H
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <map>
+
+#include "AsyncWrap.h"
+#include "ChangeToken.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief Collects the asynchronous notifications raised on a thread and posts them together.
+		 *
+		 * While a NotificationBatch is open on a thread, functions wrapped by asyncWrap are
+		 * not posted to the PropertyReactor immediately but are collected by the batch.
+		 * Notifications of the same subscriber (see SubscriberId) to the same reactor are collected
+		 * only once.
+		 * Batches may be nested: closing an inner batch hands its notifications to the outer one.
+		 *
+		 * A notification added while a ChangeTracker is open holds its token, even if the tracker
+		 * is closed before the batch. When notifications holding different tokens are merged, the
+		 * remaining one holds a joint token instead, which settles all of them once it ran.
+		 */
+		class NotificationBatch {
+			private:
+				/**
+				 * \internal
+				 * A collected notification.
+				 */
+				struct Job {
+					/**
+					 * The subscriber of the notification.
+					 */
+					SubscriberId subscriber;
+
+					/**
+					 * The function to post.
+					 */
+					boost::function<void()> func;
+
+					/**
+					 * Called if the function gets merged by an enclosing batch.
+					 */
+					boost::function<void()> dropped;
+
+					/**
+					 * The ordering key to post the function with. (See asyncPost)
+					 */
+					const void* key;
+
+					/**
+					 * The reactor to post the function to, empty for the global one. Kept alive
+					 * until the batch is flushed.
+					 */
+					boost::shared_ptr<Reactor> reactor;
+
+					/**
+					 * The priority class to post the function with.
+					 */
+					Priority::Class priority;
+
+					/**
+					 * The identity of the connection, NULL for the key. (See asyncPost)
+					 */
+					const void* source;
+
+					/**
+					 * The token held by the notification, or NULL.
+					 */
+					ChangeTokenState* completion;
+
+					/**
+					 * True if completion is a joint token made by a merge, which no tracker waits for.
+					 */
+					bool joint;
+				};
+
+				/**
+				 * \internal
+				 * The collected notifications, in the order they were raised.
+				 */
+				std::vector<Job> jobs;
+
+				/**
+				 * \internal
+				 * The subscribers already having a notification in this batch, with the reactor it is
+				 * posted to, NULL for the global one, and the index of their job.
+				 */
+				std::map<std::pair<SubscriberId, const Reactor*>, std::size_t> seen;
+
+				/**
+				 * \internal
+				 * The batch that was open on this thread when this one was opened.
+				 */
+				NotificationBatch* previous;
+
+				/**
+				 * \internal
+				 * True until the batch is flushed.
+				 */
+				bool open;
+
+				/**
+				 * \internal
+				 * The number of jobs already handed on by flush().
+				 */
+				std::size_t handed;
+
+				/**
+				 * \internal
+				 * Adds a notification, taking over the hold of its token. If an exception is thrown,
+				 * the batch is left unchanged and the hold stays with the caller.
+				 */
+				void add(const Job& job);
+
+				/**
+				 * \internal
+				 * Drops the jobs not handed on yet by a flush() which threw.
+				 */
+				void discard() noexcept;
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				NotificationBatch(const NotificationBatch& other) = delete;
+
+				/**
+				 * Opens a new batch on the calling thread.
+				 */
+				NotificationBatch();
+
+				/**
+				 * Flushes the batch if it was not flushed yet. If that fails, the notifications
+				 * not posted yet are dropped instead of throwing.
+				 */
+				~NotificationBatch();
+
+				/**
+				 * Getter for the batch open on the calling thread.
+				 * \return The innermost open batch of the calling thread or NULL.
+				 */
+				static NotificationBatch* current();
+
+				/**
+				 * Adds a notification to the batch.
+				 * \param [in] subscriber The subscriber of the notification. NULL subscribers are never merged.
+				 * \param [in] func The function to post.
+				 * \param [in] dropped Called immediately if func is merged into an earlier function of
+				 * the same subscriber and reactor, or later if an enclosing batch merges it. May be empty.
+				 * The earlier function is raised to the priority class of func if that is higher.
+				 * \param [in] key The ordering key to post the function with. (See asyncPost)
+				 * \param [in] reactor The reactor to post the function to, NULL for the global one.
+				 * \param [in] priority The priority class to post the function with.
+				 * \param [in] source The identity of the connection, NULL for the key. (See asyncPost)
+				 */
+				void add(SubscriberId subscriber, const boost::function<void()>& func,
+				         const boost::function<void()>& dropped, const void* key = NULL, Reactor* reactor = NULL,
+				         Priority::Class priority = Priority::Normal, const void* source = NULL);
+
+				/**
+				 * Closes the batch, handing the notifications to the enclosing batch or
+				 * posting them to the PropertyReactor. If an exception is thrown, the
+				 * notifications not handed on yet are dropped.
+				 */
+				void flush();
+		};
+	}
+}
+
+#endif
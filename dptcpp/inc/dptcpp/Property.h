@@ -23,13 +23,19 @@
 #ifndef DPTCPP_CONFIG_PROPERTYPROXY_H
 #define DPTCPP_CONFIG_PROPERTYPROXY_H
 
-#include <boost/shared_ptr.hpp>
-#include <boost/signals2.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/signals2/detail/slot_groups.hpp>
 #include <boost/function.hpp>
 #include <glibmm.h>
+#include <type_traits>
+#include <utility>
 
 #include "PropertyCore.h"
+#include "Reactor.h"
+#include "ChangeToken.h"
+#include "PropertyAwaiter.h"
 #include "PropertyWeak-fwd.h"
+#include "PropertyReadOnly-fwd.h"
 #include "PropertyInterface.h"
 
 namespace denprot {
@@ -37,15 +43,40 @@ namespace denprot {
 
 /**
  * \brief Property template class capable of representing a property of an arbitary type.
+ *
+ * A Property is a handle of a PropertyCore: it consists of a single intrusive pointer, so
+ * copying it costs one atomic increment and moving it is free.
  */
 template<typename T>
 class Property : public denprot::config::PropertyInterface {
 	public:
 		friend class PropertyWeak<T>;
+		friend class PropertyReadOnly<T>;
+		friend class PropertyTransaction;
+		friend class PropertyCollection;
+		friend class PropertyGraph;
+#ifdef DPTCPP_CONFIG_COROUTINES
+		template<class, class> friend class PropertyAwaiter;
+#endif
+		/**
+		 * Helper to refer to a non-copyable PropertyCore object using intrusive pointers. This is used mainly internally.
+		 */
+		typedef boost::intrusive_ptr<PropertyCore<T>> PropertyCoreDyn;
+
+		/**
+		 * The type of the value.
+		 */
+		typedef T ValueType;
+
+		/**
+		 * The type returned by getValue(). (See PropertyCore::ReadType)
+		 */
+		typedef typename PropertyCore<T>::ReadType ReadType;
+
 		/**
-		 * Helper to refer to a non-copyable PropertyCore object using shared pointers. This is used mainly internally.
+		 * An immutable snapshot of the value. (See PropertyCore::Snapshot)
 		 */
-		typedef boost::shared_ptr<PropertyCore<T>> PropertyCoreDyn;
+		typedef typename PropertyCore<T>::Snapshot Snapshot;
 	private:
 	
 		/**
@@ -56,17 +87,18 @@ class Property : public denprot::config::PropertyInterface {
 		 */
 		PropertyCoreDyn prop;
 		
-		unsigned* refCnt;
-		
-		boost::mutex* mut;
-		
-		Property(PropertyCoreDyn prop, unsigned* refCnt, boost::mutex* mut) {
-			mut->lock();
-			this->mut = mut;
-			this->prop = prop;
-			this->refCnt = refCnt;
-			++(*refCnt);
-			mut->unlock();
+		/**
+		 * \internal
+		 * Constructs a Property referring to an already existing core.
+		 */
+		explicit Property(const PropertyCoreDyn& prop) : prop(prop) {
+		}
+
+		/**
+		 * \internal
+		 * Constructs a Property taking over a reference of an already existing core.
+		 */
+		explicit Property(PropertyCoreDyn&& prop) : prop(std::move(prop)) {
 		}
 	public:
 		
@@ -74,7 +106,7 @@ class Property : public denprot::config::PropertyInterface {
 		 * \brief Experimental empty constructor
 		 */
 		Property() :
-			prop(new PropertyCore<T>()), refCnt(new unsigned(1)), mut(new boost::mutex()) {
+			prop(new PropertyCore<T>()) {
 		}
 	
 		/**
@@ -83,7 +115,16 @@ class Property : public denprot::config::PropertyInterface {
 		 * \param [in] value The value of the property
 		 */
 		Property(const Glib::ustring& name, const T& value) :
-			prop(new PropertyCore<T>(name, value)), refCnt(new unsigned(1)), mut(new boost::mutex()) {
+			prop(new PropertyCore<T>(name, value)) {
+		}
+
+		/**
+		 * \brief Constructs a new property with a given name, taking over a given value.
+		 * \param [in] name The name of the property
+		 * \param [in] value The value of the property
+		 */
+		Property(const Glib::ustring& name, T&& value) :
+			prop(new PropertyCore<T>(name, std::move(value))) {
 		}
 		
 		/**
@@ -94,24 +135,21 @@ class Property : public denprot::config::PropertyInterface {
 		 * functions connected to the changed signal. (You write code which copies by value, of course)
 		 * \param [in] p The property which should be copied
 		 */
-		Property(const Property& p) {
-			p.mut->lock();
-			prop = p.prop;
-			mut = p.mut;
-			refCnt = p.refCnt;
-			++(*refCnt);
-			p.mut->unlock();
+		Property(const Property& p) : prop(p.prop) {
+		}
+
+		/**
+		 * \brief Move-constructor for a property.
+		 *
+		 * Takes over the reference of p without touching the reference count. It does not throw,
+		 * so containers move handles instead of copying them when they grow. The moved-from
+		 * Property may only be destroyed or rebound to a core with operator*=.
+		 * \param [in] p The property which should be moved
+		 */
+		Property(Property&& p) noexcept : prop(std::move(p.prop)) {
 		}
 		
 		~Property() {
-			mut->lock();
-			--(*refCnt);
-			if(*refCnt == 0) {
-				delete refCnt;
-				mut->unlock();
-				delete mut;
-			} else
-				mut->unlock();
 		}
 		
 		/**
@@ -123,6 +161,16 @@ class Property : public denprot::config::PropertyInterface {
 			*prop = val;
 			return *this;
 		}
+
+		/**
+		 * Changes the value of this Property, taking over the value on the right side of operator=.
+		 * \param [in] val The new value of the Property.
+		 * \return A reference to this Property.
+		 */
+		Property& operator=(T&& val) {
+			*prop = std::move(val);
+			return *this;
+		}
 		
 		/**
 		 * Changes the value of this Property to the value of the one on the right side of operator=.
@@ -141,24 +189,17 @@ class Property : public denprot::config::PropertyInterface {
 		 * \return A reference to this Property.
 		 */
 		Property<T>& operator*=(const Property<T>& other) {
-			// If other refers to a different PropertyCore
-			if(refCnt != other.refCnt) {
-				mut->lock();
-				--(*refCnt);
-				if(*refCnt == 0) {
-					delete refCnt;
-					mut->unlock();
-					delete mut;
-				} else
-					mut->unlock();
-			
-				other.mut->lock();
-				mut = other.mut;
-				refCnt = other.refCnt;
-				++(*refCnt);
-				prop = other.prop;
-				other.mut->unlock();
-			}
+			prop = other.prop;
+			return *this;
+		}
+
+		/**
+		 * Changes the PropertyCore to which this Property refers to, taking over the reference of other.
+		 * \param [in] The Property whose core should be referenced by this Property instance.
+		 * \return A reference to this Property.
+		 */
+		Property<T>& operator*=(Property<T>&& other) noexcept {
+			prop = std::move(other.prop);
 			return *this;
 		}
 		
@@ -182,9 +223,78 @@ class Property : public denprot::config::PropertyInterface {
 		 * Getter for the value of the Property.
 		 * \return The value of this Property.
 		 */
-		const T& getValue() const {
+		ReadType getValue() const {
 			return prop->getValue();
 		}
+
+		/**
+		 * Takes an immutable snapshot of the value of the Property.
+		 * \return The current snapshot of the value.
+		 */
+		Snapshot getSnapshot() const {
+			return prop->getSnapshot();
+		}
+
+		/**
+		 * Getter for the number of notifications suppressed because the written value
+		 * was equal to the current one. (See PropertyCompare)
+		 * \return The number of suppressed notifications of this Property.
+		 */
+		unsigned long getSuppressedCount() const {
+			return prop->getSuppressedCount();
+		}
+
+		/**
+		 * Binds this Property to a reactor: the asynchronous subscribers connected afterwards
+		 * run in it instead of the global PropertyReactor. (See Reactor)
+		 * \param [in] reactor The reactor, or an empty pointer for the global one.
+		 */
+		void setReactor(const boost::shared_ptr<Reactor>& reactor) {
+			prop->setReactor(reactor);
+		}
+
+		/**
+		 * Getter for the reactor of this Property.
+		 * \return The reactor bound with setReactor(), or an empty pointer for the global one.
+		 */
+		boost::shared_ptr<Reactor> getReactor() const {
+			return prop->getReactor();
+		}
+
+		/**
+		 * Getter for the version of the value. It grows on every change, so a reader may cache
+		 * what it derived from the value and only read it again when the version differs.
+		 * (See PropertyCoreBase::getVersion)
+		 * \return The current version of this Property.
+		 */
+		unsigned long getVersion() const {
+			return prop->getVersion();
+		}
+
+		/**
+		 * Starts recording the changes of the value. (See PropertyCore::enableHistory)
+		 * \param [in] capacity The number of changes kept.
+		 */
+		void enableHistory(std::size_t capacity) {
+			prop->enableHistory(capacity);
+		}
+
+		/**
+		 * Reads the recorded changes of the value. (See PropertyHistory)
+		 * \return The changes still kept, oldest first. Empty if history is not enabled.
+		 */
+		std::vector<PropertyHistoryEntry<T>> getHistory() const {
+			return prop->getHistory();
+		}
+
+		/**
+		 * \internal
+		 * Getter for the type independent part of the core of this Property.
+		 * \return The core referred to by this Property.
+		 */
+		PropertyCoreBase* getCoreBase() const {
+			return prop.get();
+		}
 		
 		/**
 		 * Setter for the value of the Property.
@@ -193,7 +303,108 @@ class Property : public denprot::config::PropertyInterface {
 		void setValue(const T& nVal)  {
 			prop->setValue(nVal);
 		}
+
+		/**
+		 * Setter for the value of the Property, taking over the new value instead of copying it.
+		 * \param [in] The new value of the Property
+		 */
+		void setValue(T&& nVal) {
+			prop->setValue(std::move(nVal));
+		}
+
+		/**
+		 * Setter for the value of the Property, tracking the notifications of the change.
+		 * (See setValue)
+		 * \param [in] The new value of the Property
+		 * \return The token of the asynchronous notifications raised by the change.
+		 */
+		ChangeToken setValueTracked(const T& nVal) {
+			ChangeTracker tracker;
+			prop->setValue(nVal);
+			return tracker.close();
+		}
+
+		/**
+		 * Setter for the value of the Property taking over the new value, tracking the
+		 * notifications of the change. (See setValue)
+		 * \param [in] The new value of the Property
+		 * \return The token of the asynchronous notifications raised by the change.
+		 */
+		ChangeToken setValueTracked(T&& nVal) {
+			ChangeTracker tracker;
+			prop->setValue(std::move(nVal));
+			return tracker.close();
+		}
+
+		/**
+		 * Setter for the value of the Property, constructing the new value in place.
+		 * \param [in] args The arguments of the constructor of the value.
+		 */
+		template<class... Args>
+		void emplaceValue(Args&&... args) {
+			prop->emplaceValue(std::forward<Args>(args)...);
+		}
+
+		/**
+		 * Replaces the value by a function of the current one, atomically.
+		 * (See PropertyCore::update)
+		 * \param [in] fn The function computing the new value from the current one.
+		 * \return The new value.
+		 */
+		template<class Fn>
+		T update(Fn fn) {
+			return prop->update(fn);
+		}
+
+		/**
+		 * Changes the value to desired if it is equal to expected, atomically.
+		 * (See PropertyCore::compareExchange)
+		 * \param [in,out] expected The value expected. Set to the current value on failure.
+		 * \param [in] desired The new value.
+		 * \return True if the value was equal to expected.
+		 */
+		bool compareExchange(T& expected, const T& desired) {
+			return prop->compareExchange(expected, desired);
+		}
+
+		/**
+		 * Adds to an arithmetic value atomically. (See PropertyCore::fetchAdd)
+		 * \param [in] delta The value to add.
+		 * \return The value before the addition.
+		 */
+		template<class U = T>
+		typename std::enable_if<std::is_arithmetic<U>::value && !std::is_same<U, bool>::value, T>::type
+		fetchAdd(const T& delta) {
+			return prop->fetchAdd(delta);
+		}
+
+		/**
+		 * Subtracts from an arithmetic value atomically. (See PropertyCore::fetchSub)
+		 * \param [in] delta The value to subtract.
+		 * \return The value before the subtraction.
+		 */
+		template<class U = T>
+		typename std::enable_if<std::is_arithmetic<U>::value && !std::is_same<U, bool>::value, T>::type
+		fetchSub(const T& delta) {
+			return prop->fetchSub(delta);
+		}
 		
+		/**
+		 * Turns coalescing of notifications on or off. (See PropertyCore::setCoalesced)
+		 * \param [in] on True to coalesce notifications.
+		 */
+		void setCoalesced(bool on) {
+			prop->setCoalesced(on);
+		}
+
+		/**
+		 * Shows whether notifications of this Property are coalesced.
+		 * \return True if notifications are coalesced.
+		 */
+		bool isCoalesced() const {
+			return prop->isCoalesced();
+		}
+
 		/**
 		 * Forces this Property to notify its subscribers about the change of its value.
 		 */
@@ -205,10 +416,10 @@ class Property : public denprot::config::PropertyInterface {
 		 * Connects a new subscriber to this Property. 
 		 * \param [in] f The subscriber method to connect.
 		 * \param [in] pos The boost::connect_position of the connection. Default is at_back. 
-		 * (See boost::signals2 reference)
+		 * (See PropertySignal)
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connect(boost::function<void()> f,
+		PropertyConnection connect(boost::function<void()> f,
 		  boost::signals2::connect_position pos = boost::signals2::at_back) {
 			return prop->connect(f,pos);
 		}
@@ -216,20 +427,46 @@ class Property : public denprot::config::PropertyInterface {
 		/**
 		 * Connects a new subscriber to this Property.
 		 * \param [in] f The subscriber method to connect.
-		 * \param [in] grp The connection group of the connection. (See boost::signals2 reference)
+		 * \param [in] grp The connection group of the connection. (See PropertySignal)
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connect(boost::function<void()> f, int grp) {
+		PropertyConnection connect(boost::function<void()> f, int grp) {
 			return prop->connect(f,grp);
 		}
 		
+		/**
+		 * Connects a new subscriber to this Property. Notifications of the same subscriber
+		 * raised by one PropertyTransaction are merged, even across properties.
+		 * \param [in] f The subscriber method to connect.
+		 * \param [in] subscriber The identity of the subscriber. (See SubscriberId)
+		 * \param [in] pos The boost::connect_position of the connection. Default is at_back. 
+		 * \return A connection object to make possible disconnection and status checking.
+		 */
+		PropertyConnection connect(boost::function<void()> f, SubscriberId subscriber,
+		  boost::signals2::connect_position pos = boost::signals2::at_back) {
+			return prop->connect(f,subscriber,pos);
+		}
+
+		/**
+		 * Connects a new subscriber to this Property, with the notifications queued in a given
+		 * priority class of the reactor: they run before any queued notification of a lower class.
+		 * \param [in] f The subscriber method to connect.
+		 * \param [in] priority The priority class of the notifications. (See Priority)
+		 * \param [in] subscriber The identity of the subscriber. (See SubscriberId)
+		 * \return A connection object to make possible disconnection and status checking.
+		 */
+		PropertyConnection connect(boost::function<void()> f, Priority::Class priority,
+		  SubscriberId subscriber = NULL) {
+			return prop->connect(f,priority,subscriber);
+		}
+		
 		/**
 		 * Connects a new subscriber to this Property. 
 		 * \param [in] f The subscriber method to connect.
 		 * The connected function will run on the thread changing the property's value.
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connectLocal(boost::function<void()> f) {
+		PropertyConnection connectLocal(boost::function<void()> f) {
 			return prop->connectLocal(f);
 		}
 				
@@ -238,10 +475,10 @@ class Property : public denprot::config::PropertyInterface {
 		 * a valid reference to the Property which just changed.
 		 * \param [in] f The subscriber method to connect.
 		 * \param [in] pos The boost::connect_position of the connection. Default is at_back. 
-		 * (See boost::signals2 reference)
+		 * (See PropertySignal)
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connect(boost::function<void(Property<T>&)> f,
+		PropertyConnection connect(boost::function<void(Property<T>&)> f,
 		  boost::signals2::connect_position pos = boost::signals2::at_back) {
 			return prop->connect(*this,boost::function<void(Property<T>&)>(f),pos);
 		}
@@ -250,13 +487,24 @@ class Property : public denprot::config::PropertyInterface {
 		 * Connects a new subscriber to this Property. The subscriber will always receive
 		 * a valid reference to the Property which just changed.
 		 * \param [in] f The subscriber method to connect.
-		 * \param [in] The connection group of the connection. (See boost::signals2 reference)
+		 * \param [in] The connection group of the connection. (See PropertySignal)
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connect(boost::function<void(Property<T>&)> f, int grp) {
+		PropertyConnection connect(boost::function<void(Property<T>&)> f, int grp) {
 			return prop->connect(*this,boost::function<void(Property<T>&)>(f),grp);
 		}
 
+		/**
+		 * Connects a new subscriber to this Property. The subscriber will always receive
+		 * a valid reference to the Property which just changed.
+		 * \param [in] f The subscriber method to connect.
+		 * \param [in] priority The priority class of the notifications. (See Priority)
+		 * \return A connection object to make possible disconnection and status checking.
+		 */
+		PropertyConnection connect(boost::function<void(Property<T>&)> f, Priority::Class priority) {
+			return prop->connect(*this,boost::function<void(Property<T>&)>(f),priority);
+		}
+
 		/**
 		 * Connects a new subscriber to this Property. The subscriber will always receive
 		 * a valid reference to the Property which just changed.
@@ -264,9 +512,64 @@ class Property : public denprot::config::PropertyInterface {
 		 * \param [in] f The subscriber method to connect.
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connectLocal(boost::function<void(Property<T>&)> f) {
+		PropertyConnection connectLocal(boost::function<void(Property<T>&)> f) {
 			return prop->connectLocal(*this,boost::function<void(Property<T>&)>(f));
 		}
+#ifdef DPTCPP_CONFIG_COROUTINES
+
+		/**
+		 * Awaits the next notification of this Property: co_await prop.changed() resumes the
+		 * coroutine in the reactor of this Property, ordered with its notifications posted
+		 * without a subscriber. (See PropertyAwaiter)
+		 * \return The awaitable, resulting in the value of this Property.
+		 */
+		PropertyAwaiter<T, PropertyAnyChange> changed() const {
+			return PropertyAwaiter<T, PropertyAnyChange>(*this, PropertyAnyChange(), false, prop->getReactor(),
+			  static_cast<const PropertyCoreBase*>(prop.get()), Priority::Normal);
+		}
+
+		/**
+		 * Awaits the next notification of this Property, resuming the coroutine in a given reactor.
+		 * \param [in] reactor The reactor, or an empty pointer for the global one.
+		 * It must be kept alive until the coroutine resumed.
+		 * \param [in] key The ordering key of the resumption: coroutines resumed with the
+		 * same key never run concurrently. (See Reactor::post)
+		 * \param [in] priority The priority class of the resumption. (See Priority)
+		 * \return The awaitable, resulting in the value of this Property.
+		 */
+		PropertyAwaiter<T, PropertyAnyChange> changed(const boost::shared_ptr<Reactor>& reactor,
+		  const void* key = NULL, Priority::Class priority = Priority::Normal) const {
+			return PropertyAwaiter<T, PropertyAnyChange>(*this, PropertyAnyChange(), false, reactor, key, priority);
+		}
+
+		/**
+		 * Awaits a value of this Property meeting a condition: co_await prop.until(pred) goes on
+		 * at once if the current value meets it, otherwise the coroutine resumes in the reactor
+		 * of this Property after the first notification finding it met. (See PropertyAwaiter)
+		 * \param [in] pred The condition, called with the value on the notifying thread.
+		 * \return The awaitable, resulting in the value of this Property.
+		 */
+		template<class Pred>
+		PropertyAwaiter<T, Pred> until(Pred pred) const {
+			return PropertyAwaiter<T, Pred>(*this, std::move(pred), true, prop->getReactor(),
+			  static_cast<const PropertyCoreBase*>(prop.get()), Priority::Normal);
+		}
+
+		/**
+		 * Awaits a value of this Property meeting a condition, resuming the coroutine in a given
+		 * reactor. (See until(Pred) and changed(const boost::shared_ptr<Reactor>&, const void*, Priority::Class))
+		 * \param [in] pred The condition, called with the value on the notifying thread.
+		 * \param [in] reactor The reactor, or an empty pointer for the global one.
+		 * \param [in] key The ordering key of the resumption.
+		 * \param [in] priority The priority class of the resumption.
+		 * \return The awaitable, resulting in the value of this Property.
+		 */
+		template<class Pred>
+		PropertyAwaiter<T, Pred> until(Pred pred, const boost::shared_ptr<Reactor>& reactor,
+		  const void* key = NULL, Priority::Class priority = Priority::Normal) const {
+			return PropertyAwaiter<T, Pred>(*this, std::move(pred), true, reactor, key, priority);
+		}
+#endif
 };
 
 }
@@ -0,0 +1,276 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyArena.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyArena class and its allocator.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYARENA_H
+#define DPTCPP_CONFIG_PROPERTYARENA_H
+
+#include <boost/intrusive_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+#include "PropertyCoreBase.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief Memory of the properties of a PropertyCollection.
+		 *
+		 * Cores, handles and map nodes of a collection are carved out of large chunks, so the
+		 * properties of a parse are packed next to each other instead of being scattered over
+		 * the heap. Freed blocks are kept on per size free lists and reused by later allocations
+		 * of the same size; the chunks themselves are only returned when the arena is dropped.
+		 *
+		 * The arena is reference counted: the collection, every core and every allocator placed
+		 * in it hold a reference, so properties may safely outlive their collection. When the
+		 * collection is cleared and nobody else holds its properties, all chunks are freed at once.
+		 */
+		class PropertyArena {
+			private:
+				/**
+				 * \internal
+				 * The granularity and the maximal alignment of blocks.
+				 */
+				static const std::size_t Grain = 16;
+
+				/**
+				 * \internal
+				 * Blocks larger than this are allocated from the heap directly.
+				 */
+				static const std::size_t MaxBlock = 1024;
+
+				/**
+				 * \internal
+				 * The size of a chunk.
+				 */
+				static const std::size_t ChunkSize = 64 * 1024;
+
+				/**
+				 * \internal
+				 * A freed block, linking to the next free block of the same size.
+				 */
+				struct FreeBlock {
+					FreeBlock* next;
+				};
+
+				/**
+				 * \internal
+				 * The number of references.
+				 */
+				std::atomic<unsigned long> refs;
+
+				/**
+				 * \internal
+				 * The mutex guarding the chunks and the free lists. Allocation happens on
+				 * the thread filling the collection, but blocks may be freed on any thread.
+				 */
+				boost::mutex lock;
+
+				/**
+				 * \internal
+				 * The chunks allocated so far.
+				 */
+				std::vector<char*> chunks;
+
+				/**
+				 * \internal
+				 * The first unused byte of the last chunk and the end of that chunk.
+				 */
+				char *head, *limit;
+
+				/**
+				 * \internal
+				 * The free lists, indexed by size / Grain.
+				 */
+				FreeBlock* freeLists[MaxBlock / Grain + 1];
+
+				/**
+				 * \internal
+				 * The number of bytes handed out and not freed yet.
+				 */
+				std::size_t used;
+
+				/**
+				 * \internal
+				 * Frees the chunks.
+				 */
+				~PropertyArena();
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyArena(const PropertyArena& other) = delete;
+
+				/**
+				 * Constructs an empty arena without references. Arenas are meant to be
+				 * held by boost::intrusive_ptr.
+				 */
+				PropertyArena();
+
+				/**
+				 * Allocates a block.
+				 * \param [in] size The size of the block. The block is aligned for any type
+				 * with an alignment not greater than 16.
+				 * \return The block.
+				 */
+				void* allocate(std::size_t size);
+
+				/**
+				 * Returns a block allocated by allocate().
+				 * \param [in] p The block.
+				 * \param [in] size The size given to allocate().
+				 */
+				void deallocate(void* p, std::size_t size);
+
+				/**
+				 * Getter for the memory handed out by the arena.
+				 * \return The number of bytes allocated and not freed yet.
+				 */
+				std::size_t getUsed();
+
+				/**
+				 * Getter for the memory reserved by the arena.
+				 * \return The number of bytes of the chunks.
+				 */
+				std::size_t getReserved();
+
+				/**
+				 * Constructs a core in the arena. The core returns its memory to the arena
+				 * when it is destroyed.
+				 * \param [in] args The arguments of the constructor of the core.
+				 * \return The new core without any strong reference.
+				 */
+				template<class Core, class... Args>
+				Core* construct(Args&&... args) {
+					static_assert(std::alignment_of<Core>::value <= Grain, "PropertyArena: alignment too large");
+					void* mem = allocate(sizeof(Core));
+					Core* core;
+					try {
+						core = new (mem) Core(std::forward<Args>(args)...);
+					} catch(...) {
+						deallocate(mem, sizeof(Core));
+						throw;
+					}
+					static_cast<PropertyCoreBase*>(core)->arena = this;
+					intrusive_ptr_add_ref(this);
+					return core;
+				}
+
+				/**
+				 * Adds a reference to an arena. Used by boost::intrusive_ptr.
+				 */
+				friend void intrusive_ptr_add_ref(PropertyArena* arena) {
+					arena->refs.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				/**
+				 * Drops a reference of an arena, freeing it with the last one. Used by boost::intrusive_ptr.
+				 */
+				friend void intrusive_ptr_release(PropertyArena* arena) {
+					if(arena->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+						delete arena;
+				}
+		};
+
+		/**
+		 * \brief Standard allocator placing objects in a PropertyArena.
+		 *
+		 * Every copy of the allocator keeps the arena alive.
+		 */
+		template<class T>
+		class PropertyArenaAllocator {
+			public:
+				template<class U> friend class PropertyArenaAllocator;
+
+				typedef T value_type;
+				typedef std::true_type propagate_on_container_copy_assignment;
+				typedef std::true_type propagate_on_container_move_assignment;
+				typedef std::true_type propagate_on_container_swap;
+
+				/**
+				 * Rebinding to another type.
+				 */
+				template<class U>
+				struct rebind {
+					typedef PropertyArenaAllocator<U> other;
+				};
+			private:
+				/**
+				 * \internal
+				 * The arena.
+				 */
+				boost::intrusive_ptr<PropertyArena> arena;
+			public:
+				/**
+				 * Constructs an allocator using a given arena.
+				 * \param [in] arena The arena.
+				 */
+				explicit PropertyArenaAllocator(const boost::intrusive_ptr<PropertyArena>& arena) : arena(arena) {
+				}
+
+				/**
+				 * Converts an allocator of another type.
+				 */
+				template<class U>
+				PropertyArenaAllocator(const PropertyArenaAllocator<U>& other) : arena(other.arena) {
+				}
+
+				/**
+				 * Allocates memory for n objects.
+				 */
+				T* allocate(std::size_t n) {
+					return static_cast<T*>(arena->allocate(n * sizeof(T)));
+				}
+
+				/**
+				 * Frees memory allocated by allocate().
+				 */
+				void deallocate(T* p, std::size_t n) {
+					arena->deallocate(p, n * sizeof(T));
+				}
+
+				/**
+				 * Getter for the arena.
+				 * \return The arena used by the allocator.
+				 */
+				const boost::intrusive_ptr<PropertyArena>& getArena() const {
+					return arena;
+				}
+
+				template<class U>
+				bool operator==(const PropertyArenaAllocator<U>& other) const {
+					return arena == other.arena;
+				}
+
+				template<class U>
+				bool operator!=(const PropertyArenaAllocator<U>& other) const {
+					return arena != other.arena;
+				}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyAwaiter.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyAwaiter template class, available when compiling with coroutine
+ * support (C++20). DPTCPP_CONFIG_COROUTINES is defined if it is.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYAWAITER_H
+#define DPTCPP_CONFIG_PROPERTYAWAITER_H
+
+#if defined(__cpp_impl_coroutine)
+#define DPTCPP_CONFIG_COROUTINES 1
+
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <coroutine>
+#include <exception>
+
+#include "Property-fwd.h"
+#include "PropertyWaitList.h"
+#include "AsyncWrap.h"
+#include "Exception.h"
+
+namespace denprot {
+	namespace config {
+		class Reactor;
+
+		/**
+		 * The condition of Property::changed(), met by any value.
+		 */
+		struct PropertyAnyChange {
+			template<class V>
+			bool operator()(const V&) const {
+				return true;
+			}
+		};
+
+		/**
+		 * \brief The awaitable returned by Property::changed() and Property::until().
+		 *
+		 * co_await suspends the coroutine until a notification of the property finds the
+		 * condition met, then resumes it in a reactor like an asynchronous notification without
+		 * a subscriber: after the notifications queued earlier with the same key, and after the
+		 * NotificationBatch or PropertyTransaction the change belongs to is closed. The key
+		 * works as a strand: coroutines resumed with the same key never run concurrently.
+		 *
+		 * The awaiter is the wait list entry itself and the resumption is a single coroutine handle
+		 * in the small object buffer of boost::function, so waiting allocates nothing beyond the
+		 * coroutine frame. The property is connected to its wait list once, not once per waiter.
+		 *
+		 * The condition is tested on the thread notifying the property, with the wait list of the
+		 * property locked, so it must be cheap and must not wait on the property. An exception
+		 * thrown by it resumes the coroutine and is rethrown by co_await.
+		 * The result of co_await is the value of the property when the coroutine resumes, which
+		 * may already differ from the one that met the condition.
+		 *
+		 * If the resumption can not be queued (the reactor is not started, or posting fails), the
+		 * coroutine is resumed on the notifying thread instead, and co_await throws an Exception
+		 * (or the exception of the failed post).
+		 *
+		 * A coroutine must not be destroyed while it waits for a notification which has already
+		 * been raised: the resumption is queued in the reactor. Destroying it before that
+		 * removes the awaiter from the wait list.
+		 */
+		template<class T, class Pred>
+		class PropertyAwaiter : public PropertyWaiter {
+			private:
+				/**
+				 * \internal
+				 * The property waited for. The handle keeps the property alive while waiting.
+				 */
+				Property<T> prop;
+
+				/**
+				 * \internal
+				 * The condition of the value.
+				 */
+				Pred pred;
+
+				/**
+				 * \internal
+				 * False for changed(): the current value is not tested before suspending.
+				 */
+				bool immediate;
+
+				/**
+				 * \internal
+				 * The reactor resuming the coroutine, empty for the global one.
+				 */
+				boost::shared_ptr<Reactor> reactor;
+
+				/**
+				 * \internal
+				 * The ordering key of the resumption.
+				 */
+				const void* key;
+
+				/**
+				 * \internal
+				 * The priority class of the resumption.
+				 */
+				Priority::Class priority;
+
+				/**
+				 * \internal
+				 * The wait list of the property, NULL until the coroutine suspends.
+				 */
+				PropertyWaitList* list;
+
+				/**
+				 * \internal
+				 * The waiting coroutine.
+				 */
+				std::coroutine_handle<> handle;
+
+				/**
+				 * \internal
+				 * The exception thrown by the condition while suspended.
+				 */
+				std::exception_ptr error;
+
+				/**
+				 * \internal
+				 * The function posted to resume the coroutine.
+				 */
+				struct Resume {
+					std::coroutine_handle<> handle;
+
+					void operator()() const {
+						handle.resume();
+					}
+				};
+
+				/**
+				 * \internal
+				 * Resumes the coroutine in place with an error, if the resumption could not be posted.
+				 */
+				struct Drop {
+					PropertyAwaiter* awaiter;
+
+					void operator()() const {
+						awaiter->fail(std::make_exception_ptr(
+						  Exception("PropertyAwaiter: the resumption was dropped, the reactor is not started", CodePos)));
+					}
+				};
+
+				/**
+				 * \internal
+				 * Resumes the coroutine on the calling thread, making co_await throw. An exception
+				 * thrown by the condition takes precedence. The awaiter may be destroyed by the call.
+				 */
+				void fail(std::exception_ptr e) {
+					if(!error)
+						error = e;
+					std::coroutine_handle<> h = handle;
+					h.resume();
+				}
+
+				/**
+				 * \internal
+				 * Tests the condition for the wait list.
+				 */
+				bool ready() {
+					try {
+						return pred(prop.getValue());
+					} catch(...) {
+						error = std::current_exception();
+						return true;
+					}
+				}
+
+				/**
+				 * \internal
+				 * Queues the resumption of the coroutine, or resumes it with an error if that fails.
+				 */
+				void wake() {
+					Resume resume = { handle };
+					Drop drop = { this };
+					try {
+						asyncPost(boost::function<void()>(resume), NULL, boost::function<void()>(drop), key,
+						  reactor.get(), priority);
+					} catch(...) {
+						fail(std::current_exception());
+					}
+				}
+			public:
+				/**
+				 * Constructs an awaiter. Use Property::changed() or Property::until() instead.
+				 * \param [in] prop The property to wait for.
+				 * \param [in] pred The condition of the value.
+				 * \param [in] immediate True if the condition is tested on the current value as well.
+				 * \param [in] reactor The reactor resuming the coroutine, empty for the global one.
+				 * It must be kept alive until the coroutine resumed.
+				 * \param [in] key The ordering key of the resumption.
+				 * \param [in] priority The priority class of the resumption.
+				 */
+				PropertyAwaiter(const Property<T>& prop, Pred pred, bool immediate,
+				  const boost::shared_ptr<Reactor>& reactor, const void* key, Priority::Class priority) :
+					prop(prop), pred(std::move(pred)), immediate(immediate), reactor(reactor), key(key),
+					priority(priority), list(NULL) {
+				}
+
+				/**
+				 * Leaves the wait list if the coroutine is destroyed while waiting.
+				 */
+				~PropertyAwaiter() {
+					if(list)
+						list->remove(*this);
+				}
+
+				bool await_ready() {
+					return immediate && pred(prop.getValue());
+				}
+
+				/**
+				 * Joins the wait list, unless the condition got met meanwhile.
+				 * \return False if the coroutine goes on without suspending.
+				 */
+				bool await_suspend(std::coroutine_handle<> h) {
+					handle = h;
+					list = &prop.prop->getWaitList();
+					return list->add(*this, immediate);
+				}
+
+				typename Property<T>::ReadType await_resume() {
+					if(error)
+						std::rethrow_exception(error);
+					return prop.getValue();
+				}
+		};
+	}
+}
+
+#endif
+
+#endif
@@ -19,12 +19,19 @@
 #define DPTCPP_CONFIG_PROPERTYCOLLECTION_H
 
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/intrusive_ptr.hpp>
 #include <map>
 #include <glibmm.h>
 #include <sstream>
+#include <type_traits>
+#include <atomic>
+#include <utility>
+#include <ostream>
 #include "Property.h"
 #include "Exception.h"
 #include "PropertyInterface.h"
+#include "PropertyArena.h"
 
 namespace denprot {
 	namespace config {
@@ -32,10 +39,57 @@ namespace denprot {
 		class PropertyCollection {
 			public:
 				typedef boost::shared_ptr<PropertyCollection> Dyn;
-				typedef std::map<Glib::ustring, boost::shared_ptr<denprot::config::PropertyInterface>> PMap;
+				typedef std::map<Glib::ustring, boost::shared_ptr<denprot::config::PropertyInterface>,
+				  std::less<Glib::ustring>,
+				  PropertyArenaAllocator<std::pair<const Glib::ustring,
+				    boost::shared_ptr<denprot::config::PropertyInterface>>>> PMap;
 			private:
+				boost::intrusive_ptr<PropertyArena> arena;
 				PMap propMap;
+
+				/**
+				 * \internal
+				 * The collection-wide version, bumped by every add, remove and clear and by the
+				 * writes of the properties in the collection. (See getVersion)
+				 */
+				boost::shared_ptr<std::atomic<unsigned long>> version;
 				PropertyCollection();
+
+				/**
+				 * \internal
+				 * Makes the writes of a property bump the version of this collection.
+				 * \throw Exception If the property is already in a collection.
+				 */
+				void join(PropertyCoreBase* core, const Glib::ustring& name);
+				void added();
+				
+				/**
+				 * \internal
+				 * Creates a new property in the PropertyArena of this collection, forwarding
+				 * the value to the constructor of the core.
+				 */
+				template<class T, class V>
+				Property<T> emplaceProperty(const Glib::ustring& name, V&& value) {
+					auto it = propMap.lower_bound(name);
+					if(it != propMap.end() && !(name < it->first)) {
+						std::stringstream strm;
+						strm << "Property with name '" << name
+							 << "' already exists in this PropertyCollection" << std::endl;
+						throw Exception(strm.str().c_str(),CodePos);
+					}
+					Property<T> prop(typename Property<T>::PropertyCoreDyn(
+					  arena->construct<PropertyCore<T>>(name, std::forward<V>(value))));
+					join(prop.getCoreBase(), name);
+					try {
+						it = propMap.insert(it, PMap::value_type(name, boost::allocate_shared<Property<T>>(
+						  PropertyArenaAllocator<Property<T>>(arena), prop)));
+					} catch(...) {
+						prop.getCoreBase()->leaveCollection();
+						throw;
+					}
+					added();
+					return prop;
+				}
 			public:
 				static Dyn create();
 				
@@ -55,15 +109,69 @@ namespace denprot {
 					return *(boost::static_pointer_cast<Property<T>>(it->second));
 				}
 				
+				/**
+				 * Adds a property to this collection.
+				 * \param [in] name The name of the property.
+				 * \param [in] prop The property.
+				 * \throw Exception If a property with the same name is already in the collection, or
+				 * if the property is already in a collection. (See getVersion)
+				 */
 				void add(const Glib::ustring& name,
 				          denprot::config::PropertyInterface::Dyn prop);
 				
+				/**
+				 * Creates a new property in this collection. The property is allocated in the
+				 * PropertyArena of the collection, next to the other properties created this way.
+				 * \param [in] name The name of the property.
+				 * \param [in] value The value of the property.
+				 * \return The new property.
+				 */
+				template<class T>
+				Property<T> newProperty(const Glib::ustring& name, const T& value) {
+					return emplaceProperty<T>(name, value);
+				}
+				
+				/**
+				 * Creates a new property in this collection, taking over its value.
+				 * (See newProperty(const Glib::ustring&, const T&))
+				 * \param [in] name The name of the property.
+				 * \param [in] value The value of the property. Unspecified after the call.
+				 * \return The new property.
+				 */
+				template<class T>
+				Property<T> newProperty(const Glib::ustring& name, typename std::remove_reference<T>::type&& value) {
+					return emplaceProperty<T>(name, std::move(value));
+				}
+				
+				boost::intrusive_ptr<PropertyArena> getArena() const;
+				
 				bool hasProperty(const Glib::ustring& name) const;
 				
 				void removeProperty(const Glib::ustring& name);
 				
 				ClassIdRep getClassId(const Glib::ustring& name) const;
 				
+				unsigned long getSuppressedCount() const;
+				
+				unsigned long getVersion(const Glib::ustring& name) const;
+				
+				/**
+				 * Getter for the collection-wide version. It grows whenever a property is added or
+				 * removed and whenever a contained property changes: the properties bump it on
+				 * every write, so a property can be in only one collection at a time.
+				 * \return The current collection-wide version.
+				 */
+				unsigned long getVersion() const;
+				
+				/**
+				 * Writes the recorded changes of every property with history enabled,
+				 * one change per line. (See PropertyHistory::dump)
+				 * \param [in] out The stream to write to.
+				 */
+				void dumpHistories(std::ostream& out) const;
+				
+				~PropertyCollection();
+				
 				void clear();
 				
 				PMap::const_iterator begin() const;
@@ -0,0 +1,152 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyCompare.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyCompare trait.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYCOMPARE_H
+#define DPTCPP_CONFIG_PROPERTYCOMPARE_H
+
+#include <type_traits>
+#include <utility>
+
+namespace denprot {
+	namespace config {
+		template<class T>
+		class HasEqualityOperator;
+
+		/**
+		 * \internal
+		 * Detects at compile time whether T declares a nested value_type.
+		 */
+		template<class T>
+		class HasValueType {
+			private:
+				template<class U>
+				static std::true_type test(typename U::value_type*);
+
+				template<class U>
+				static std::false_type test(...);
+			public:
+				static const bool value = decltype(test<T>(0))::value;
+		};
+
+		/**
+		 * \internal
+		 * Detects at compile time whether the elements of T can be compared with operator==.
+		 * The operator== of the standard containers and of std::pair is declared for any element
+		 * type, but can only be instantiated if the elements are comparable. True for other types.
+		 */
+		template<class T, bool = HasValueType<T>::value>
+		struct HasComparableElements : std::true_type {
+		};
+
+		/**
+		 * \internal
+		 * Detects at compile time whether the elements of a container can be compared with operator==.
+		 */
+		template<class T>
+		struct HasComparableElements<T, true> : std::integral_constant<bool,
+		  std::is_same<typename std::remove_cv<typename T::value_type>::type, T>::value ||
+		  HasEqualityOperator<typename std::remove_cv<typename T::value_type>::type>::value> {
+		};
+
+		/**
+		 * \internal
+		 * Detects at compile time whether the members of a pair can be compared with operator==.
+		 */
+		template<class A, class B>
+		struct HasComparableElements<std::pair<A, B>, false> : std::integral_constant<bool,
+		  HasEqualityOperator<typename std::remove_cv<A>::type>::value &&
+		  HasEqualityOperator<typename std::remove_cv<B>::type>::value> {
+		};
+
+		/**
+		 * \internal
+		 * Detects at compile time whether two const T objects can be compared with operator==.
+		 * Containers and pairs are only reported comparable if their elements are, recursively.
+		 */
+		template<class T>
+		class HasEqualityOperator {
+			private:
+				template<class U>
+				static auto test(int) -> typename std::is_convertible<
+				  decltype(std::declval<const U&>() == std::declval<const U&>()), bool>::type;
+
+				template<class U>
+				static std::false_type test(...);
+			public:
+				static const bool value = decltype(test<T>(0))::value && HasComparableElements<T>::value;
+		};
+
+		/**
+		 * \brief Decides whether writing a value equal to the current one notifies subscribers.
+		 *
+		 * By default a PropertyCore compares the written value to the current one with operator==
+		 * whenever the type has one, and an equal write changes nothing and notifies nobody.
+		 * Standard containers and pairs count as comparable only if their elements are. The detection
+		 * only sees declarations, so a type whose operator== is declared but can not be instantiated
+		 * (for example a custom container of an incomparable type) must opt out by specializing this
+		 * template with enabled = false.
+		 */
+		template<class T>
+		struct PropertyCompare {
+			/**
+			 * True if equal writes are suppressed.
+			 */
+			static const bool enabled = HasEqualityOperator<T>::value;
+
+			/**
+			 * Compares two values. Only used if enabled is true.
+			 */
+			static bool equal(const T& a, const T& b) {
+				return a == b;
+			}
+		};
+
+		/**
+		 * \internal
+		 * Compares two values if comparison is enabled for their type, otherwise reports them different.
+		 */
+		template<class T>
+		inline bool propertyEqual(const T& a, const T& b, std::true_type) {
+			return PropertyCompare<T>::equal(a, b);
+		}
+
+		/**
+		 * \internal
+		 * Compares two values if comparison is enabled for their type, otherwise reports them different.
+		 */
+		template<class T>
+		inline bool propertyEqual(const T& a, const T& b, std::false_type) {
+			return false;
+		}
+
+		/**
+		 * \internal
+		 * Compares two values if comparison is enabled for their type, otherwise reports them different.
+		 */
+		template<class T>
+		inline bool propertyEqual(const T& a, const T& b) {
+			return propertyEqual(a, b, std::integral_constant<bool, PropertyCompare<T>::enabled>());
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyConnection.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyConnection class.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYCONNECTION_H
+#define DPTCPP_CONFIG_PROPERTYCONNECTION_H
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <atomic>
+#include <vector>
+
+namespace denprot {
+	namespace config {
+		struct PropertySlot;
+
+		/**
+		 * \internal
+		 * \brief The keeper of the slots of a signal, told when one of them is disconnected.
+		 * (See PropertySignal)
+		 */
+		class PropertySlotOwner {
+			public:
+				/**
+				 * Called after a slot of the owner was disconnected through its PropertyConnection.
+				 * \param [out] dropped Receives the slots the owner no longer references, so they are
+				 * destroyed by the caller after it released its locks.
+				 */
+				virtual void slotDisconnected(std::vector<boost::shared_ptr<PropertySlot>>& dropped) = 0;
+			protected:
+				~PropertySlotOwner() {
+				}
+		};
+
+		/**
+		 * \internal
+		 * \brief The link from the slots of a signal to their owner, cut when the owner is destroyed.
+		 */
+		struct PropertySlotLink {
+			/**
+			 * The mutex guarding owner.
+			 */
+			boost::mutex lock;
+
+			/**
+			 * The owner of the slots, NULL once it was destroyed.
+			 */
+			PropertySlotOwner* owner;
+
+			explicit PropertySlotLink(PropertySlotOwner* owner) : owner(owner) {
+			}
+		};
+
+		/**
+		 * \internal
+		 * \brief A subscriber function connected to a PropertySignal.
+		 */
+		struct PropertySlot {
+			/**
+			 * The connected function.
+			 */
+			boost::function<void()> func;
+
+			/**
+			 * Cleared on disconnection. Emission skips disconnected slots.
+			 */
+			std::atomic<bool> connected;
+
+			/**
+			 * The region of the slot: 0 for ungrouped slots connected at the front,
+			 * 1 for grouped slots and 2 for ungrouped slots connected at the back.
+			 */
+			int region;
+
+			/**
+			 * The group of the slot, only used in region 1.
+			 */
+			int group;
+
+			/**
+			 * The link to the signal holding the slot.
+			 */
+			boost::weak_ptr<PropertySlotLink> link;
+
+			/**
+			 * Constructs a connected slot.
+			 */
+			PropertySlot(const boost::function<void()>& func, int region, int group) :
+				func(func), connected(true), region(region), group(group) {
+			}
+		};
+
+		/**
+		 * \brief Handle of a subscriber connected to a property.
+		 *
+		 * The handle only holds a weak reference to the connection, so it does not keep the
+		 * subscriber function alive and it may outlive the property.
+		 * Disconnecting takes effect immediately: a disconnected function is not called by
+		 * any emission starting afterwards. (Like with boost::signals2, it may still be running
+		 * if an emission was already calling it.)
+		 */
+		class PropertyConnection {
+			private:
+				/**
+				 * \internal
+				 * The connected slot.
+				 */
+				boost::weak_ptr<PropertySlot> slot;
+			public:
+				/**
+				 * Constructs a handle referring to no connection.
+				 */
+				PropertyConnection() {
+				}
+
+				/**
+				 * \internal
+				 * Constructs a handle referring to a slot.
+				 */
+				explicit PropertyConnection(const boost::shared_ptr<PropertySlot>& slot) : slot(slot) {
+				}
+
+				/**
+				 * Disconnects the subscriber. Does nothing if it is already disconnected.
+				 * The signal is told, so it can drop its disconnected slots.
+				 */
+				void disconnect() const {
+					boost::shared_ptr<PropertySlot> s = slot.lock();
+					if(!s || !s->connected.exchange(false, std::memory_order_acq_rel))
+						return;
+					boost::shared_ptr<PropertySlotLink> link = s->link.lock();
+					if(!link)
+						return;
+					std::vector<boost::shared_ptr<PropertySlot>> dropped;
+					boost::lock_guard<boost::mutex> lck(link->lock);
+					if(link->owner)
+						link->owner->slotDisconnected(dropped);
+				}
+
+				/**
+				 * Shows whether the subscriber is still connected.
+				 * \return True if the subscriber is connected to a living property.
+				 */
+				bool connected() const {
+					boost::shared_ptr<PropertySlot> s = slot.lock();
+					return s && s->connected.load(std::memory_order_acquire);
+				}
+		};
+	}
+}
+
+#endif
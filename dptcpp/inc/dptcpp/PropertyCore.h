@@ -24,20 +24,35 @@
 #define DPTCPP_CONFIG_PROPERTY_H
 
 #include <glibmm.h>
-#include <boost/signals2.hpp>
+#include "PropertySignal.h"
 #include <boost/function.hpp>
-#include <boost/thread/shared_mutex.hpp>
-#include <boost/thread/locks.hpp>
 #include <boost/weak_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
 #include <iostream>
 
 #include "Property-fwd.h"
+#include "PropertyHistory.h"
 #include "PropertyWeak.h"
+#include "PropertyValue.h"
+#include "PropertyCoreBase.h"
+#include "PropertyWaitList.h"
+#include "PropertyInterface.h"
 #include "AsyncWrap.h"
 #include "IdentifiableClass.h"
 #include "IdTypes.h"
 #include "Debug.h"
 #include "ClassIdClass.h"
+#include "Exception.h"
 
 namespace denprot {
 	namespace config {
@@ -47,9 +62,10 @@ namespace denprot {
 		 * A pair of unicode strings, association of a name and a value.
 		 * This is a simple variable concept, where other components can subscribe
 		 * for changes of the value of a given property.
+		 * The lifetime of a core is managed by the handles referring to it. (See PropertyCoreBase)
 		 */
 		template<typename T>
-		class PropertyCore : denprot::IdentifiableClass {
+		class PropertyCore : public PropertyCoreBase, denprot::IdentifiableClass {
 			private:
 				/**
 				 * \internal
@@ -59,28 +75,345 @@ namespace denprot {
 		
 				/**
 				 * \internal
-				 * The value of the PropertyCore.
+				 * The value of the PropertyCore, together with the synchronization
+				 * suiting its type.
 				 */
-				T value;
+				PropertyValue<T> value;
 		
 				/**
 				 * \internal
 				 * The signal emitted when the property gets changed.
 				 */
-				boost::signals2::signal<void()> changedSignal;
+				PropertySignal changedSignal;
 		
 				/**
 				 * \internal
-				 * The mutex protecting this property.
+				 * True if notifications of the asynchronous subscribers are coalesced.
 				 */
-				mutable boost::shared_mutex mut;
+				std::atomic<bool> coalesced;
+
+				/**
+				 * \internal
+				 * The waiters of the property, NULL until the first one arrives. (See getWaitList)
+				 */
+				PropertyWaitList* waitList;
+
+				/**
+				 * \internal
+				 * Creates waitList once.
+				 */
+				std::once_flag waitOnce;
+
+				/**
+				 * \internal
+				 * The state of a derived property. (See DerivedProperty)
+				 */
+				struct Derivation {
+					/**
+					 * Computes the value from the inputs.
+					 */
+					boost::function<T()> compute;
+
+					/**
+					 * The connections to the changed signals of the inputs.
+					 */
+					std::vector<PropertyConnection> inputs;
+
+					/**
+					 * The mutex serializing recomputations and changes of the inputs.
+					 */
+					boost::mutex lock;
+				};
+
+				/**
+				 * \internal
+				 * The derivation of the value, NULL for plain properties.
+				 */
+				boost::scoped_ptr<Derivation> derivation;
+
+				/**
+				 * \internal
+				 * The number of invalidations of the value. Only ever bumped for derived properties.
+				 */
+				std::atomic<unsigned long> invalidated;
+
+				/**
+				 * \internal
+				 * The value of invalidated the stored value was computed at. The value is dirty
+				 * while the two differ.
+				 */
+				mutable std::atomic<unsigned long> computed;
+
+				/**
+				 * \internal
+				 * Shows whether the value has to be recomputed before it is read.
+				 */
+				bool stale() const {
+					return invalidated.load(std::memory_order_acquire) != computed.load(std::memory_order_acquire);
+				}
+
+				/**
+				 * \internal
+				 * Recomputes the value of a derived property if it is dirty. The value is
+				 * a cache of the result of the computation, so this is logically const.
+				 */
+				void refresh() const {
+					boost::lock_guard<boost::mutex> lck(derivation->lock);
+					unsigned long generation = invalidated.load(std::memory_order_acquire);
+					if(generation == computed.load(std::memory_order_relaxed))
+						return;
+					const_cast<PropertyValue<T>&>(value).store(derivation->compute());
+					// The value stays dirty until it is stored, so readers meanwhile wait for the
+					// lock instead of reading the old value; an input changing during the
+					// computation has bumped invalidated and keeps it dirty.
+					computed.store(generation, std::memory_order_release);
+				}
+
+				/**
+				 * \internal
+				 * Bumps the version after a change and records the change in the history, if any.
+				 * Called by the value under its writer lock.
+				 * \param [in] stored The new value or snapshot. (See PropertyValue::Stored)
+				 */
+				void changed(const typename PropertyValue<T>::Stored& stored) {
+					unsigned long v = bumpVersion();
+					PropertyHistoryBase* h = getHistoryBase();
+					if(h)
+						static_cast<PropertyHistory<T>*>(h)->record(v, stored);
+				}
+
+				/**
+				 * \internal
+				 * The hook passed to the value by writers, calling changed().
+				 */
+				struct Recorder {
+					PropertyCore<T>* core;
+
+					explicit Recorder(PropertyCore<T>* core) : core(core) {
+					}
+
+					void operator()(const typename PropertyValue<T>::Stored& stored) const {
+						core->changed(stored);
+					}
+				};
+
+				/**
+				 * \internal
+				 * Applies a read-modify-write operation to the value and notifies the
+				 * subscribers if it changed. (See PropertyValue::storeUpdate)
+				 */
+				template<class Fn>
+				void modify(Fn fn) {
+					stored(value.storeUpdate(fn, Recorder(this)));
+				}
+
+				/**
+				 * \internal
+				 * Notifies the subscribers after a write, or counts the suppressed
+				 * notification if the value did not change.
+				 */
+				void stored(bool changed) {
+					if(!changed) {
+						countSuppressed();
+						return;
+					}
+					changedSignal();
+				}
+
+				/**
+				 * \internal
+				 * A subscriber function of an asynchronous connection, shared by the wrapper in
+				 * the changed signal and the notifications queued in the PropertyReactor. Every
+				 * queued notification holds one reference, taken when it is posted and dropped
+				 * when it runs or is merged away, so the notification itself is a plain pointer:
+				 * it fits into the small object buffer of boost::function and is copied through
+				 * the queues without allocating or touching the reference count.
+				 */
+				struct AsyncTarget {
+					/**
+					 * The subscriber function.
+					 */
+					boost::function<void()> func;
+
+					/**
+					 * True while a coalesced notification is queued.
+					 */
+					std::atomic<bool> pending;
+
+					/**
+					 * The number of references: one for the wrapper and one per queued notification.
+					 */
+					std::atomic<unsigned> refs;
+
+					/**
+					 * The reactor running the notifications, empty for the global one. It is not
+					 * owned: a notification must never hold the last reference of its reactor.
+					 */
+					boost::weak_ptr<Reactor> reactor;
+
+					/**
+					 * The priority class of the notifications.
+					 */
+					Priority::Class priority;
+
+					AsyncTarget(const boost::function<void()>& func, const boost::shared_ptr<Reactor>& reactor,
+					  Priority::Class priority) : func(func), pending(false), refs(0), reactor(reactor), priority(priority) {
+					}
+
+					/**
+					 * Drops the reference of a notification even if the subscriber throws.
+					 */
+					struct Release {
+						AsyncTarget* target;
+						~Release() {
+							intrusive_ptr_release(target);
+						}
+					};
+
+					/**
+					 * Runs a queued notification.
+					 */
+					static void run(AsyncTarget* target) {
+						Release r = { target };
+						target->func();
+					}
+
+					/**
+					 * Runs a queued coalesced notification, allowing the next one to be posted.
+					 */
+					static void runCoalesced(AsyncTarget* target) {
+						Release r = { target };
+						target->pending.store(false, std::memory_order_release);
+						target->func();
+					}
+
+					/**
+					 * Drops a notification which will never run: merged into an earlier one
+					 * (see NotificationBatch) or not posted.
+					 */
+					static void drop(AsyncTarget* target) {
+						target->pending.store(false, std::memory_order_release);
+						intrusive_ptr_release(target);
+					}
+
+					friend void intrusive_ptr_add_ref(AsyncTarget* target) {
+						target->refs.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					friend void intrusive_ptr_release(AsyncTarget* target) {
+						if(target->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+							delete target;
+					}
+				};
+
+				/**
+				 * \internal
+				 * Puts an asynchronous wrapper around a subscriber function. (See asyncWrap)
+				 * When the property is coalesced, the wrapper posts a new notification only if
+				 * the previous one of the same connection has already started running.
+				 * The notifications run in the reactor the core is bound to when connecting.
+				 * \param [in] func The subscriber function.
+				 * \param [in] subscriber The identity of the subscriber.
+				 * \param [in] priority The priority class of the notifications.
+				 * \return The wrapper to connect to the changed signal.
+				 */
+				boost::function<void()> wrapAsync(const boost::function<void()>& func, SubscriberId subscriber,
+				  Priority::Class priority = Priority::Normal) {
+					boost::intrusive_ptr<AsyncTarget> target(new AsyncTarget(func, getReactor(), priority));
+					const std::atomic<bool>* coalesce = &coalesced;
+					const void* key = static_cast<const PropertyCoreBase*>(this);
+					return [target, subscriber, coalesce, key]() {
+						AsyncTarget* t = target.get();
+						boost::shared_ptr<Reactor> reactor;
+						if(!t->reactor.empty()) {
+							reactor = t->reactor.lock();
+							// The reactor is gone, and its subscribers with it.
+							if(!reactor)
+								return;
+						}
+						bool merge = coalesce->load(std::memory_order_relaxed);
+						if(merge && t->pending.exchange(true, std::memory_order_acq_rel))
+							return;
+						intrusive_ptr_add_ref(t);
+						try {
+							if(merge)
+								asyncPost([t]() { AsyncTarget::runCoalesced(t); }, subscriber, [t]() { AsyncTarget::drop(t); },
+								  key, reactor.get(), t->priority, t);
+							else
+								asyncPost([t]() { AsyncTarget::run(t); }, subscriber, [t]() { AsyncTarget::drop(t); },
+								  key, reactor.get(), t->priority, t);
+						} catch(...) {
+							// Nothing was queued: a later change has to be able to post again.
+							AsyncTarget::drop(t);
+							throw;
+						}
+					};
+				}
+
+				/**
+				 * \internal
+				 * Binds a subscriber taking the Property to a weak reference of it. On every call the
+				 * reference is raised to a Property on the stack, so delivery does not allocate.
+				 * \param [in] p The Property to pass to the subscriber.
+				 * \param [in] func The subscriber function.
+				 * \return The function to connect to the changed signal.
+				 */
+				static boost::function<void()> bindHandle(Property<T>& p, const boost::function<void(Property<T>&)>& func) {
+					PropertyWeak<T> weak(p);
+					return [weak, func]() {
+						boost::optional<Property<T>> strong = weak.raise();
+						if(!strong)
+							std::cerr << "Failed to call back changed signal event : Property does not exist anymore!" << std::endl;
+						else
+							func(*strong);
+					};
+				}
+			protected:
+				/**
+				 * \internal
+				 * Drops the subscribers when the last handle of the property is gone, since
+				 * they may keep weak references to this core.
+				 */
+				void expire() {
+					changedSignal.disconnectAll();
+					if(derivation) {
+						// The compute function usually holds handles of the inputs, whose signals keep
+						// this core until they drop the disconnected slots: release it to break the cycle.
+						// It is destroyed after the lock, since that may expire the inputs.
+						boost::function<T()> compute;
+						boost::lock_guard<boost::mutex> lck(derivation->lock);
+						for(auto it = derivation->inputs.begin(); it != derivation->inputs.end(); ++it)
+							it->disconnect();
+						derivation->inputs.clear();
+						compute.swap(derivation->compute);
+					}
+				}
+
+				/**
+				 * \internal
+				 * The size of the core. (See PropertyCoreBase::footprint)
+				 */
+				std::size_t footprint() const {
+					return sizeof(PropertyCore<T>);
+				}
 			public:
+				/**
+				 * The type returned by getValue(). (See PropertyValue)
+				 */
+				typedef typename PropertyValue<T>::ReadType ReadType;
+
+				/**
+				 * An immutable snapshot of the value. (See PropertyValue)
+				 */
+				typedef typename PropertyValue<T>::Snapshot Snapshot;
+
 				/**
 				 * Copying is prohibited.
 				 */
 				PropertyCore(const PropertyCore<T>& p) = delete;
 		
 				~PropertyCore() { 
+					delete waitList;
 				 }
 		
 				/**
@@ -104,6 +437,17 @@ namespace denprot {
 					setValue(val);
 					return *this;
 				}
+
+				/**
+				 * Changes the value of this PropertyCore, taking over the value on
+				 * the right side of operator=.
+				 * \param [in] val The new value of the PropertyCore.
+				 * \return A reference to this PropertyCore.
+				 */
+				PropertyCore<T>& operator=(T&& val) {
+					setValue(std::move(val));
+					return *this;
+				}
 		
 	
 				/**
@@ -112,13 +456,22 @@ namespace denprot {
 				 * \param [in] The value of the property.
 				 */
 				PropertyCore(const Glib::ustring& name, const T& value) :
-					name(name), value(value) {
+					name(name), value(value), coalesced(false), waitList(NULL), invalidated(0), computed(0) {
+				}
+
+				/**
+				 * \brief Constructs a PropertyCore with a given name, taking over a given value.
+				 * \param [in] The name of the property.
+				 * \param [in] The value of the property.
+				 */
+				PropertyCore(const Glib::ustring& name, T&& value) :
+					name(name), value(std::move(value)), coalesced(false), waitList(NULL), invalidated(0), computed(0) {
 				}
 				
 				/**
 				 * \brief Experimental empty constructor.
 				 */
-				PropertyCore() {
+				PropertyCore() : coalesced(false), waitList(NULL), invalidated(0), computed(0) {
 				}
 		
 				/**
@@ -126,7 +479,6 @@ namespace denprot {
 				 * \return The ClassId of the Class this PropertyCore is instantiated with.
 				 */
 				denprot::ClassIdRep getClassId() const {
-					boost::shared_lock<boost::shared_mutex> lck(mut);
 					return denprot::ClassId<T>::id();
 				}
 		
@@ -142,31 +494,291 @@ namespace denprot {
 				 * Getter for the value of the property.
 				 * \return The value of the property.
 				 */
-				const T& getValue() const {
-					boost::shared_lock<boost::shared_mutex> acc(mut);
-					return value;
+				ReadType getValue() const {
+					if(stale())
+						refresh();
+					return value.load();
+				}
+
+				/**
+				 * Takes an immutable snapshot of the value of the property. Later changes
+				 * of the property do not affect the snapshot. For large values this
+				 * is much cheaper than getValue() as it does not copy the value.
+				 * \return The current snapshot of the value.
+				 */
+				Snapshot getSnapshot() const {
+					if(stale())
+						refresh();
+					return value.snapshot();
 				}
 		
 				/**
 				 * Changes the value of the property, notifying all of its subscribers.
+				 * If the new value is equal to the current one, nothing is changed and
+				 * nobody is notified. (See PropertyCompare)
 				 * \param [in] The new value of the PropertyCore.
 				 */
 				void setValue(const T& nValue) {
-					{
-						boost::unique_lock<boost::shared_mutex> lck(mut);
-						value = nValue;
-					}
-					changedSignal();
+					stored(value.storeChanged(nValue, Recorder(this)));
+				}
+
+				/**
+				 * Changes the value of the property, taking over the new value instead of
+				 * copying it. (See setValue(const T&))
+				 * \param [in] The new value of the PropertyCore. Unspecified after the call.
+				 */
+				void setValue(T&& nValue) {
+					stored(value.storeChanged(std::move(nValue), Recorder(this)));
+				}
+
+				/**
+				 * Changes the value of the property to a value constructed in place from
+				 * the given arguments, notifying all of its subscribers. (See setValue)
+				 * \param [in] args The arguments of the constructor of the value.
+				 */
+				template<class... Args>
+				void emplaceValue(Args&&... args) {
+					stored(value.storeEmplaced(Recorder(this), std::forward<Args>(args)...));
+				}
+		
+				/**
+				 * Changes the value of the property without notifying its subscribers.
+				 * Used by PropertyTransaction, which notifies them later with notifyChanged().
+				 * \param [in] The new value of the PropertyCore.
+				 * \return True if the value was changed, false if it was equal to the new one.
+				 */
+				bool setValueSilently(const T& nValue) {
+					return value.storeChanged(nValue, Recorder(this));
+				}
+
+				/**
+				 * Changes the value of the property without notifying its subscribers,
+				 * taking over the new value. (See setValueSilently(const T&))
+				 * \param [in] The new value of the PropertyCore. Unspecified after the call.
+				 * \return True if the value was changed, false if it was equal to the new one.
+				 */
+				bool setValueSilently(T&& nValue) {
+					return value.storeChanged(std::move(nValue), Recorder(this));
 				}
 		
+				/**
+				 * Edits the value in place without notifying the subscribers. The edit works on
+				 * a private copy of the value which is published only if the edit reports a change;
+				 * the result is not compared to the current value. (See CollectionProperty)
+				 * \param [in] fn Called as fn(current, next) under the writer lock of the property.
+				 * It must return true if it changed next.
+				 * \return True if the value was changed.
+				 */
+				template<class Fn>
+				bool editSilently(Fn fn) {
+					return value.storeEdited(fn, Recorder(this));
+				}
+
+				/**
+				 * Notifies the subscribers of a change stored silently, without bumping the
+				 * version again as forceChange() does.
+				 */
+				void notifyChanged() {
+					changedSignal();
+				}
+
 				/**
 				 * Forces emission of the changed signal on the property even if
-				 * the value didn't change.
+				 * the value didn't change. The version is bumped as well.
 				 */
 				void forceChange() {
+					bumpVersion();
 					changedSignal();
 				}
+
+				/**
+				 * Getter for the waiters of the property. The list is created on the first call and
+				 * connected to the changed signal as a single subscriber, woken on every notification.
+				 * \return The wait list of the property.
+				 */
+				PropertyWaitList& getWaitList() {
+					std::call_once(waitOnce, [this]() {
+						std::unique_ptr<PropertyWaitList> list(new PropertyWaitList());
+						PropertyWaitList* target = list.get();
+						changedSignal.connect([target]() { target->notify(); });
+						waitList = list.release();
+					});
+					return *waitList;
+				}
 		
+				/**
+				 * Replaces the value by a function of the current one. No other writer can
+				 * change the value between the read and the write, so unlike
+				 * setValue(getValue() + 1) no update is lost. The subscribers are notified
+				 * only if the value changed.
+				 * \param [in] fn The function computing the new value from the current one.
+				 * It runs under the writer lock of the property, so it must not write the property.
+				 * \return The new value.
+				 */
+				template<class Fn>
+				T update(Fn fn) {
+					boost::optional<T> rv;
+					modify([&fn, &rv](const T& current, T& next) {
+						next = fn(current);
+						rv = next;
+						return true;
+					});
+					return *rv;
+				}
+
+				/**
+				 * Changes the value to desired if it is equal to expected, atomically.
+				 * Values are compared with PropertyCompare, like equal writes are detected, so it
+				 * must be enabled for T. The subscribers are notified only if the value changed.
+				 * \param [in,out] expected The value expected. Set to the current value on failure.
+				 * \param [in] desired The new value.
+				 * \return True if the value was equal to expected.
+				 */
+				bool compareExchange(T& expected, const T& desired) {
+					static_assert(PropertyCompare<T>::enabled, "compareExchange needs PropertyCompare enabled for the value type");
+					bool rv = false;
+					modify([&expected, &desired, &rv](const T& current, T& next) {
+						if(!PropertyCompare<T>::equal(current, expected)) {
+							expected = current;
+							return false;
+						}
+						rv = true;
+						next = desired;
+						return true;
+					});
+					return rv;
+				}
+
+				/**
+				 * Adds to an arithmetic value atomically. The subscribers are notified
+				 * only if the value changed.
+				 * \param [in] delta The value to add.
+				 * \return The value before the addition.
+				 */
+				template<class U = T>
+				typename std::enable_if<std::is_arithmetic<U>::value && !std::is_same<U, bool>::value, T>::type
+				fetchAdd(const T& delta) {
+					T rv = T();
+					modify([&delta, &rv](const T& current, T& next) {
+						rv = current;
+						next = current + delta;
+						return true;
+					});
+					return rv;
+				}
+
+				/**
+				 * Subtracts from an arithmetic value atomically. The subscribers are notified
+				 * only if the value changed.
+				 * \param [in] delta The value to subtract.
+				 * \return The value before the subtraction.
+				 */
+				template<class U = T>
+				typename std::enable_if<std::is_arithmetic<U>::value && !std::is_same<U, bool>::value, T>::type
+				fetchSub(const T& delta) {
+					T rv = T();
+					modify([&delta, &rv](const T& current, T& next) {
+						rv = current;
+						next = current - delta;
+						return true;
+					});
+					return rv;
+				}
+
+				/**
+				 * Starts recording the changes of the value in a ring buffer. (See PropertyHistory)
+				 * The ring is allocated here, recording a change does not allocate. Only changes
+				 * made by setValue() and setValueSilently() are recorded, not forceChange() and
+				 * not the recomputations of a derived property. Calling it again does nothing.
+				 * \param [in] capacity The number of changes kept.
+				 * \throw Exception If capacity is zero.
+				 */
+				void enableHistory(std::size_t capacity) {
+					if(capacity == 0)
+						throw Exception("History capacity must be positive",CodePos);
+					if(getHistoryBase())
+						return;
+					PropertyHistory<T>* h = new PropertyHistory<T>(capacity);
+					if(!installHistory(h))
+						delete h;
+				}
+
+				/**
+				 * Reads the recorded changes of the value without blocking writers.
+				 * \return The changes still kept, oldest first. Empty if history is not enabled.
+				 */
+				std::vector<PropertyHistoryEntry<T>> getHistory() const {
+					PropertyHistoryBase* h = getHistoryBase();
+					if(!h)
+						return std::vector<PropertyHistoryEntry<T>>();
+					return static_cast<PropertyHistory<T>*>(h)->read();
+				}
+
+				/**
+				 * Turns the property into a derived one: its value is computed by a function
+				 * of other properties when it is read after any of them changed. (See DerivedProperty)
+				 * \param [in] compute The function computing the value.
+				 */
+				void derive(const boost::function<T()>& compute) {
+					derivation.reset(new Derivation());
+					derivation->compute = compute;
+					invalidated.fetch_add(1, std::memory_order_release);
+				}
+
+				/**
+				 * Makes a derived property depend on another property. Changes of the input
+				 * mark the value dirty and are reported to the subscribers of this property.
+				 * \param [in] input The property the value depends on.
+				 */
+				void addInput(PropertyInterface& input) {
+					PropertyWeak<T> weak(this);
+					PropertyConnection c = input.connectLocal([weak]() {
+						boost::intrusive_ptr<PropertyCore<T>> core = weak.lock();
+						if(core)
+							core->invalidate();
+					});
+					boost::lock_guard<boost::mutex> lck(derivation->lock);
+					derivation->inputs.push_back(c);
+				}
+
+				/**
+				 * Marks the value of a derived property dirty and notifies the subscribers.
+				 * The value is only recomputed when it is read.
+				 */
+				void invalidate() {
+					invalidated.fetch_add(1, std::memory_order_release);
+					bumpVersion();
+					changedSignal();
+				}
+
+				/**
+				 * Shows whether the value of a derived property will be recomputed on the next read.
+				 * \return True if any input changed since the value was computed last.
+				 */
+				bool isDirty() const {
+					return stale();
+				}
+
+				/**
+				 * Turns coalescing of notifications on or off. When on, at most one notification
+				 * per asynchronous connection is queued in the PropertyReactor at any time: changes
+				 * made while it is queued are reported by that same notification. Subscribers always
+				 * read the latest value when they run, so no change is missed, only merged.
+				 * Connections made with connectLocal are not affected.
+				 * \param [in] on True to coalesce notifications.
+				 */
+				void setCoalesced(bool on) {
+					coalesced.store(on, std::memory_order_relaxed);
+				}
+
+				/**
+				 * Shows whether notifications of this property are coalesced.
+				 * \return True if notifications are coalesced.
+				 */
+				bool isCoalesced() const {
+					return coalesced.load(std::memory_order_relaxed);
+				}
+
 				/**
 				 * Connects a new subscriber to the changed signal of this property.
 				 * The function will always receive a valid reference of the Property as a parameter.
@@ -176,20 +788,9 @@ namespace denprot {
 				 * \return A connection that can be stored and used to check its 
 				 * integrity or disconnect from the signal.
 				 */
-				boost::signals2::connection connect(Property<T>& p, boost::function<void(Property<T>&)> func,
+				PropertyConnection connect(Property<T>& p, boost::function<void(Property<T>&)> func,
 				  boost::signals2::connect_position pos) {
-					PropertyWeak<T> weak(p);
-					auto wrap = [weak, func]() {
-						PropertyWeak<T> w2 = weak;
-						Property<T>* ptr = NULL;
-						if(!w2.raise(&ptr)) {
-							std::cerr << "Failed to call back changed signal event : Property does not exist anymore!" << std::endl;
-						} else {
-							func(*ptr);
-							delete ptr;
-						}
-					};
-					return changedSignal.connect(asyncWrap(boost::function<void()>(wrap)));
+					return changedSignal.connect(wrapAsync(bindHandle(p, func), NULL),pos);
 				}
 
 				/**
@@ -197,23 +798,26 @@ namespace denprot {
 				 * The function will always receive a valid reference of the Property as a parameter.
 				 * \param [in] p The Property to pass a reference of to the connected function.
 				 * \param [in] func The function to connect to this PropertyCore.
-				 * \param [in] grp The group of the connection. (See boost::signals2 reference)
+				 * \param [in] grp The group of the connection. (See PropertySignal)
 				 * \return A connection that can be stored and used to check its 
 				 * integrity or disconnect from the signal.
 				 */
-				boost::signals2::connection connect(Property<T>& p, boost::function<void(Property<T>&)> func, int grp) {
-					PropertyWeak<T> weak(p);
-					auto wrap = [weak, func]() {
-						PropertyWeak<T> w2 = weak;
-						Property<T>* ptr = NULL;
-						if(!w2.raise(&ptr)) {
-							std::cerr << "Failed to call back changed signal event : Property does not exist anymore!" << std::endl;
-						} else {
-							func(*ptr);
-							delete ptr;
-						}
-					};
-					return changedSignal.connect(grp,asyncWrap(boost::function<void()>(wrap)));
+				PropertyConnection connect(Property<T>& p, boost::function<void(Property<T>&)> func, int grp) {
+					return changedSignal.connect(grp,wrapAsync(bindHandle(p, func), NULL));
+				}
+
+				/**
+				 * Connects a new subscriber to the changed signal of this property.
+				 * The function will always receive a valid reference of the Property as a parameter.
+				 * \param [in] p The Property to pass a reference of to the connected function.
+				 * \param [in] func The function to connect to this PropertyCore.
+				 * \param [in] priority The priority class of the notifications. (See Priority)
+				 * \return A connection that can be stored and used to check its 
+				 * integrity or disconnect from the signal.
+				 */
+				PropertyConnection connect(Property<T>& p, boost::function<void(Property<T>&)> func,
+				  Priority::Class priority) {
+					return changedSignal.connect(wrapAsync(bindHandle(p, func), NULL, priority));
 				}
 
 				/**
@@ -224,19 +828,8 @@ namespace denprot {
 				 * \return A connection that can be stored and used to check its 
 				 * integrity or disconnect from the signal.
 				 */
-				boost::signals2::connection connectLocal(Property<T>& p, boost::function<void(Property<T>&)> func) {
-					PropertyWeak<T> weak(p);
-					auto wrap = [weak, func]() {
-						PropertyWeak<T> w2 = weak;
-						Property<T>* ptr = NULL;
-						if(!w2.raise(&ptr)) {
-							std::cerr << "Failed to call back changed signal event : Property does not exist anymore!" << std::endl;
-						} else {
-							func(*ptr);
-							delete ptr;
-						}
-					};
-					return changedSignal.connect(boost::function<void()>(wrap));
+				PropertyConnection connectLocal(Property<T>& p, boost::function<void(Property<T>&)> func) {
+					return changedSignal.connect(bindHandle(p, func));
 				}
 				
 				/**
@@ -246,20 +839,49 @@ namespace denprot {
 				 * \return A connection that can be stored and used to check its 
 				 * integrity or disconnect from the signal.
 				 */
-				boost::signals2::connection connect(boost::function<void()> func,
+				PropertyConnection connect(boost::function<void()> func,
 				  boost::signals2::connect_position pos) {
-					return changedSignal.connect(asyncWrap(func),pos);
+					return changedSignal.connect(wrapAsync(func, NULL),pos);
 				}
 
 				/**
 				 * Connects a new subscriber to the changed signal of this property.
 				 * \param [in] func The function to connect to this PropertyCore.
-				 * \param [in] grp The connection group of the connection. (See boost::signals2 reference)
+				 * \param [in] grp The connection group of the connection. (See PropertySignal)
+				 * \return A connection that can be stored and used to check its 
+				 * integrity or disconnect from the signal.
+				 */
+				PropertyConnection connect(boost::function<void()> func, int grp) {
+					return changedSignal.connect(grp, wrapAsync(func, NULL));
+				}
+				
+				/**
+				 * Connects a new subscriber to the changed signal of this property.
+				 * Notifications of the same subscriber raised by one PropertyTransaction
+				 * are merged, even across properties.
+				 * \param [in] func The function to connect to this PropertyCore.
+				 * \param [in] subscriber The identity of the subscriber. (See SubscriberId)
+				 * \param [in] pos The position of the connection. (See boost::signals2::connect_position)
+				 * \return A connection that can be stored and used to check its 
+				 * integrity or disconnect from the signal.
+				 */
+				PropertyConnection connect(boost::function<void()> func, SubscriberId subscriber,
+				  boost::signals2::connect_position pos) {
+					return changedSignal.connect(wrapAsync(func, subscriber),pos);
+				}
+
+				/**
+				 * Connects a new subscriber to the changed signal of this property, with the
+				 * notifications queued in a given priority class of the reactor.
+				 * \param [in] func The function to connect to this PropertyCore.
+				 * \param [in] priority The priority class of the notifications. (See Priority)
+				 * \param [in] subscriber The identity of the subscriber. (See SubscriberId)
 				 * \return A connection that can be stored and used to check its 
 				 * integrity or disconnect from the signal.
 				 */
-				boost::signals2::connection connect(boost::function<void()> func, int grp) {
-					return changedSignal.connect(grp, asyncWrap(func));
+				PropertyConnection connect(boost::function<void()> func, Priority::Class priority,
+				  SubscriberId subscriber) {
+					return changedSignal.connect(wrapAsync(func, subscriber, priority));
 				}
 				
 				/**
@@ -269,7 +891,7 @@ namespace denprot {
 				 * \return A connection that can be stored and used to check its 
 				 * integrity or disconnect from the signal.
 				 */
-				boost::signals2::connection connectLocal(boost::function<void()> func) {
+				PropertyConnection connectLocal(boost::function<void()> func) {
 					return changedSignal.connect(func);
 				}
 		};
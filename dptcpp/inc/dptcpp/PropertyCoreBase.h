@@ -0,0 +1,289 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyCoreBase.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyCoreBase class.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYCOREBASE_H
+#define DPTCPP_CONFIG_PROPERTYCOREBASE_H
+
+#include <boost/shared_ptr.hpp>
+#include <atomic>
+#include <cstddef>
+
+namespace denprot {
+	namespace config {
+		class PropertyArena;
+		class PropertyHistoryBase;
+		class Reactor;
+
+		/**
+		 * \brief The type independent part of every PropertyCore.
+		 *
+		 * Holds the reference counts of the core, so handles (Property, PropertyReadOnly)
+		 * only store a single boost::intrusive_ptr and the core is the only allocation made
+		 * for a property.
+		 *
+		 * Strong references keep the property alive. PropertyWeak objects hold weak references
+		 * which only keep the memory of the core: when the last strong reference is dropped the
+		 * core is expired (its subscribers are dropped) and it is deleted once the last weak
+		 * reference is gone too.
+		 *
+		 * A core constructed in a PropertyArena returns its memory to the arena instead of the heap.
+		 */
+		class PropertyCoreBase {
+			public:
+				friend class PropertyArena;
+			private:
+				/**
+				 * \internal
+				 * The number of strong references.
+				 */
+				mutable std::atomic<unsigned> strongRefs;
+
+				/**
+				 * \internal
+				 * The number of weak references, plus one as long as there is any strong reference.
+				 */
+				mutable std::atomic<unsigned> weakRefs;
+
+				/**
+				 * \internal
+				 * The number of notifications suppressed because the written value was equal to the current one.
+				 */
+				std::atomic<unsigned long> suppressed;
+
+				/**
+				 * \internal
+				 * The version of the value, bumped on every change and notification.
+				 */
+				std::atomic<unsigned long> version;
+
+				/**
+				 * \internal
+				 * The arena holding the core, or NULL if it was allocated with new.
+				 */
+				PropertyArena* arena;
+
+				/**
+				 * \internal
+				 * The version of the collection holding the core, bumped along with version, or
+				 * NULL if the core is in no collection. (See PropertyCollection::getVersion)
+				 */
+				std::atomic<std::atomic<unsigned long>*> collectionVersion;
+
+				/**
+				 * \internal
+				 * Keeps the counter of the last collection joined alive, so writes may still bump it
+				 * after the core has left the collection and the collection is gone.
+				 */
+				boost::shared_ptr<std::atomic<unsigned long>> collectionVersionOwner;
+
+				/**
+				 * \internal
+				 * The history of the value, or NULL if it is not recorded. Set at most once.
+				 */
+				std::atomic<PropertyHistoryBase*> history;
+
+				/**
+				 * \internal
+				 * The reactor running the asynchronous subscribers, or empty for the global one.
+				 */
+				boost::shared_ptr<Reactor> reactor;
+
+				/**
+				 * \internal
+				 * Destroys the core and frees its memory.
+				 */
+				void destroy() const;
+			protected:
+				/**
+				 * Called when the last strong reference is dropped. Implementations should
+				 * release everything that may hold weak references to the core itself.
+				 */
+				virtual void expire() = 0;
+
+				/**
+				 * Getter for the size of the most derived object, needed to return the
+				 * memory of the core to its arena.
+				 */
+				virtual std::size_t footprint() const = 0;
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyCoreBase(const PropertyCoreBase& other) = delete;
+
+				/**
+				 * Constructs a core without any strong references.
+				 */
+				PropertyCoreBase() : strongRefs(0), weakRefs(1), suppressed(0), version(0), arena(NULL),
+					collectionVersion(NULL), history(NULL) {
+				}
+
+				/**
+				 * Frees the history.
+				 */
+				virtual ~PropertyCoreBase();
+
+				/**
+				 * Adds a weak reference to the core.
+				 */
+				void weakAddRef() const {
+					weakRefs.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				/**
+				 * Drops a weak reference, deleting the core if it was the last reference of any kind.
+				 */
+				void weakRelease() const {
+					if(weakRefs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+						destroy();
+				}
+
+				/**
+				 * Tries to turn a weak reference into a strong one.
+				 * \return True if a strong reference was added, false if the core was already expired.
+				 */
+				bool tryAddRef() const {
+					unsigned n = strongRefs.load(std::memory_order_relaxed);
+					while(n != 0) {
+						if(strongRefs.compare_exchange_weak(n, n + 1, std::memory_order_acquire,
+						                                    std::memory_order_relaxed))
+							return true;
+					}
+					return false;
+				}
+
+				/**
+				 * Records a notification suppressed because the written value did not change.
+				 */
+				void countSuppressed() {
+					suppressed.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				/**
+				 * Getter for the number of suppressed notifications.
+				 * \return The number of writes which did not notify the subscribers because
+				 * the value was equal to the current one.
+				 */
+				unsigned long getSuppressedCount() const {
+					return suppressed.load(std::memory_order_relaxed);
+				}
+
+				/**
+				 * Bumps the version of the core and of the collection holding it. Must be called
+				 * after the new value has been stored.
+				 * \return The new version.
+				 */
+				unsigned long bumpVersion() {
+					unsigned long v = version.fetch_add(1, std::memory_order_release) + 1;
+					std::atomic<unsigned long>* c = collectionVersion.load(std::memory_order_acquire);
+					if(c)
+						c->fetch_add(1, std::memory_order_release);
+					return v;
+				}
+
+				/**
+				 * Makes the writes of the core bump the version of a collection. A core is in at
+				 * most one collection; it may not join one while another thread writes it.
+				 * \param [in] v The version of the collection.
+				 * \return False if the core is already in a collection.
+				 */
+				bool joinCollection(const boost::shared_ptr<std::atomic<unsigned long>>& v) {
+					std::atomic<unsigned long>* expected = NULL;
+					if(!collectionVersion.compare_exchange_strong(expected, v.get(), std::memory_order_acq_rel))
+						return false;
+					collectionVersionOwner = v;
+					return true;
+				}
+
+				/**
+				 * Stops the writes of the core bumping the version of its collection.
+				 */
+				void leaveCollection() {
+					collectionVersion.store(NULL, std::memory_order_release);
+				}
+
+				/**
+				 * Getter for the version of the value. The version starts at zero and only grows:
+				 * comparing it to an earlier result tells whether the property has changed since.
+				 * A value read after the version is at least as new as the version.
+				 * \return The current version.
+				 */
+				unsigned long getVersion() const {
+					return version.load(std::memory_order_acquire);
+				}
+
+				/**
+				 * Getter for the history of the value.
+				 * \return The history, or NULL if the changes of this core are not recorded.
+				 */
+				PropertyHistoryBase* getHistoryBase() const {
+					return history.load(std::memory_order_acquire);
+				}
+
+				/**
+				 * Installs the history of the value, unless there is one already.
+				 * \param [in] h The history. The core takes its ownership if it is installed.
+				 * \return True if h was installed.
+				 */
+				bool installHistory(PropertyHistoryBase* h) {
+					PropertyHistoryBase* expected = NULL;
+					return history.compare_exchange_strong(expected, h, std::memory_order_acq_rel);
+				}
+
+				/**
+				 * Binds the core to a reactor. Asynchronous subscribers connected afterwards run
+				 * in that reactor. (See Reactor)
+				 * \param [in] r The reactor, or an empty pointer for the global one.
+				 */
+				void setReactor(const boost::shared_ptr<Reactor>& r) {
+					boost::atomic_store(&reactor, r);
+				}
+
+				/**
+				 * Getter for the reactor of the core.
+				 * \return The reactor bound with setReactor(), or an empty pointer for the global one.
+				 */
+				boost::shared_ptr<Reactor> getReactor() const {
+					return boost::atomic_load(&reactor);
+				}
+
+				/**
+				 * Adds a strong reference to a core. Used by boost::intrusive_ptr.
+				 */
+				friend void intrusive_ptr_add_ref(const PropertyCoreBase* core) {
+					core->strongRefs.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				/**
+				 * Drops a strong reference of a core. Used by boost::intrusive_ptr.
+				 */
+				friend void intrusive_ptr_release(const PropertyCoreBase* core) {
+					if(core->strongRefs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+						const_cast<PropertyCoreBase*>(core)->expire();
+						core->weakRelease();
+					}
+				}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyGraph.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyGraph class.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYGRAPH_H
+#define DPTCPP_CONFIG_PROPERTYGRAPH_H
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
+#include <map>
+#include <atomic>
+
+#include "Property.h"
+#include "PropertyInterface.h"
+#include "PropertyCoreBase.h"
+#include "PropertyConnection.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief Keeps properties computed from other properties up to date, without glitches.
+		 *
+		 * Every property defined by define() is recomputed eagerly when any of its inputs changes.
+		 * Changes propagate in waves: a wave evaluates the affected properties in topological order,
+		 * each of them at most once, and only if one of its inputs actually changed during the wave
+		 * (so writing an equal value cuts the propagation short). Values are written silently and
+		 * the subscribers of the changed properties are notified only after the whole wave, in one
+		 * NotificationBatch, so no subscriber observes a half propagated state.
+		 *
+		 * The guarantee covers the subscribers of the computed properties. The asynchronous
+		 * subscribers of a source are posted when the source changes, before the wave runs, so
+		 * they may still read computed values of the previous wave. Change the sources inside a
+		 * NotificationBatch or a PropertyTransaction to have them posted after the wave as well.
+		 *
+		 * Cycles are detected when a property is defined, and rejected with an Exception.
+		 * Writes made by subscribers during the notification of a wave start a new wave after it.
+		 * Waves of one graph are serialized; the graph keeps its properties alive.
+		 */
+		class PropertyGraph {
+			private:
+				/**
+				 * \internal
+				 * A property taking part in the graph.
+				 */
+				struct Node {
+					/**
+					 * A handle keeping the property alive.
+					 */
+					PropertyInterface::Dyn handle;
+
+					/**
+					 * The properties this one is computed from. Empty for sources.
+					 */
+					std::vector<Node*> inputs;
+
+					/**
+					 * The properties computed from this one.
+					 */
+					std::vector<Node*> dependents;
+
+					/**
+					 * The topological rank: greater than the rank of every input.
+					 */
+					unsigned rank;
+
+					/**
+					 * Recomputes and silently stores the value. Returns true if the value changed.
+					 * Empty for sources.
+					 */
+					boost::function<bool()> evaluate;
+
+					/**
+					 * Notifies the subscribers of the property.
+					 */
+					boost::function<void()> notify;
+
+					/**
+					 * The connection to the changed signal of the property.
+					 */
+					PropertyConnection connection;
+
+					/**
+					 * The last wave in which the node was reached.
+					 */
+					unsigned long affectedIn;
+
+					/**
+					 * The last wave in which the value of the node changed.
+					 */
+					unsigned long changedIn;
+				};
+
+				/**
+				 * \internal
+				 * The nodes, by their cores.
+				 */
+				std::map<PropertyCoreBase*, boost::shared_ptr<Node>> nodes;
+
+				/**
+				 * \internal
+				 * The mutex serializing waves and definitions.
+				 */
+				boost::mutex lock;
+
+				/**
+				 * \internal
+				 * Nodes changed by subscribers during the current wave, starting the next wave.
+				 */
+				std::vector<Node*> pending;
+
+				/**
+				 * \internal
+				 * The node being notified, whose own change is not a new change.
+				 */
+				Node* notifying;
+
+				/**
+				 * \internal
+				 * The number of the current wave.
+				 */
+				unsigned long waveNo;
+
+				/**
+				 * \internal
+				 * Statistics.
+				 */
+				std::atomic<unsigned long> waves, evaluations;
+
+				/**
+				 * \internal
+				 * Finds or creates the node of a property. Created nodes are appended to created.
+				 */
+				Node* node(const PropertyInterface::Dyn& handle, std::vector<Node*>& created);
+
+				/**
+				 * \internal
+				 * Registers a computed property.
+				 */
+				void define(const PropertyInterface::Dyn& target, const boost::function<bool()>& evaluate,
+				  const boost::function<void()>& notify, const std::vector<PropertyInterface::Dyn>& inputs);
+
+				/**
+				 * \internal
+				 * Called when the value of a node changed.
+				 */
+				void changed(Node* n);
+
+				/**
+				 * \internal
+				 * Runs waves until no change is pending, even if some of them fail. The first
+				 * failure is rethrown afterwards. The caller must hold the mutex.
+				 */
+				void run(Node* force);
+
+				/**
+				 * \internal
+				 * True if the calling thread is running a wave of this graph.
+				 */
+				bool isWaveThread() const;
+
+				/**
+				 * \internal
+				 * Runs one wave starting from the pending changes and the node forced to be evaluated.
+				 * If a compute function throws, the nodes already changed are notified before the
+				 * exception is rethrown.
+				 */
+				void wave(Node* force);
+
+				/**
+				 * \internal
+				 * Collects copies of the input handles.
+				 */
+				static void collect(std::vector<PropertyInterface::Dyn>&) {
+				}
+
+				/**
+				 * \internal
+				 * Collects copies of the input handles.
+				 */
+				template<class Input, class... Inputs>
+				static void collect(std::vector<PropertyInterface::Dyn>& v, const Input& input, const Inputs&... inputs) {
+					v.push_back(PropertyInterface::Dyn(new Input(input)));
+					collect(v, inputs...);
+				}
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyGraph(const PropertyGraph& other) = delete;
+
+				/**
+				 * Constructs an empty graph.
+				 */
+				PropertyGraph();
+
+				/**
+				 * Disconnects from all the properties of the graph.
+				 */
+				~PropertyGraph();
+
+				/**
+				 * Defines a property as computed from other properties. The value is computed
+				 * immediately, and again whenever an input changes.
+				 * \param [in] target The property to compute. It may be an input of other definitions,
+				 * but may be defined only once.
+				 * \param [in] compute The function (or lambda) computing the value, returning something
+				 * convertible to T. It should read the inputs itself.
+				 * \param [in] inputs The handles (Property, PropertyReadOnly...) of the inputs.
+				 * \throw Exception If the target is already defined or the definition would make a cycle.
+				 * The graph is left unchanged then. An exception thrown by the first computation is
+				 * rethrown, but the definition stays.
+				 */
+				template<class T, class Fn, class... Inputs>
+				void define(const Property<T>& target, const Fn& compute, const Inputs&... inputs) {
+					std::vector<PropertyInterface::Dyn> in;
+					collect(in, inputs...);
+					Property<T> p = target;
+					define(PropertyInterface::Dyn(new Property<T>(target)),
+					  [p, compute]() { return p.prop->setValueSilently(compute()); },
+					  [p]() { p.prop->notifyChanged(); }, in);
+				}
+
+				/**
+				 * Getter for the number of properties in the graph.
+				 * \return The number of sources and computed properties.
+				 */
+				unsigned size();
+
+				/**
+				 * Getter for the number of waves run so far.
+				 * \return The number of waves.
+				 */
+				unsigned long getWaves() const;
+
+				/**
+				 * Getter for the number of evaluations so far.
+				 * \return The number of times a compute function was called.
+				 */
+				unsigned long getEvaluations() const;
+		};
+	}
+}
+
+#endif
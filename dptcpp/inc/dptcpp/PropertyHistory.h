@@ -0,0 +1,317 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyHistory.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyHistory template class.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYHISTORY_H
+#define DPTCPP_CONFIG_PROPERTYHISTORY_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_array.hpp>
+#include <glibmm.h>
+#include <type_traits>
+#include <ostream>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+#include <utility>
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief A recorded change of a property.
+		 */
+		template<typename T>
+		struct PropertyHistoryEntry {
+			/**
+			 * The time of the change.
+			 */
+			std::chrono::system_clock::time_point time;
+
+			/**
+			 * The version of the property after the change. (See PropertyCoreBase::getVersion)
+			 */
+			unsigned long version;
+
+			/**
+			 * The value written.
+			 */
+			T value;
+		};
+
+		/**
+		 * \internal
+		 * Detects at compile time whether a const T can be written to a std::ostream.
+		 */
+		template<class T>
+		class HasOutputOperator {
+			private:
+				template<class U>
+				static auto test(int) -> decltype(std::declval<std::ostream&>() << std::declval<const U&>(), std::true_type());
+
+				template<class U>
+				static std::false_type test(...);
+			public:
+				static const bool value = decltype(test<T>(0))::value;
+		};
+
+		/**
+		 * \internal
+		 * Writes a value with operator<<.
+		 */
+		template<class T>
+		inline void historyFormat(std::ostream& out, const T& value, std::true_type) {
+			out << value;
+		}
+
+		/**
+		 * \internal
+		 * Stands in for values which can not be written to a stream.
+		 */
+		template<class T>
+		inline void historyFormat(std::ostream& out, const T& value, std::false_type) {
+			out << '?';
+		}
+
+		/**
+		 * \brief The type independent interface of a PropertyHistory.
+		 */
+		class PropertyHistoryBase {
+			public:
+				virtual ~PropertyHistoryBase() {
+				}
+
+				/**
+				 * Writes the recorded changes as text, one per line, oldest first.
+				 * \param [in] out The stream to write to.
+				 * \param [in] name The name of the property, written at the start of every line.
+				 */
+				virtual void dump(std::ostream& out, const Glib::ustring& name) const = 0;
+		};
+
+		/**
+		 * \internal
+		 * \brief The value stored in a slot of a PropertyHistory.
+		 *
+		 * Trivially copyable values are copied into atomic words, so a reader racing with the
+		 * writer of the slot reads garbage which is then discarded, never undefined behaviour.
+		 * The value is assembled in raw storage, so T need not be default constructible.
+		 */
+		template<typename T, bool Trivial = std::is_trivially_copyable<T>::value>
+		class PropertyHistorySlot {
+			private:
+				static const std::size_t Words = (sizeof(T) + sizeof(std::size_t) - 1) / sizeof(std::size_t);
+				std::atomic<std::size_t> words[Words];
+			public:
+				void put(const T& value) {
+					std::size_t buf[Words] = {};
+					std::memcpy(buf, &value, sizeof(T));
+					for(std::size_t i = 0; i < Words; ++i)
+						words[i].store(buf[i], std::memory_order_relaxed);
+				}
+
+				T get() const {
+					std::size_t buf[Words];
+					for(std::size_t i = 0; i < Words; ++i)
+						buf[i] = words[i].load(std::memory_order_relaxed);
+					typename std::aligned_storage<sizeof(T), alignof(T)>::type rv;
+					std::memcpy(&rv, buf, sizeof(T));
+					return *reinterpret_cast<const T*>(&rv);
+				}
+		};
+
+		/**
+		 * \internal
+		 * \brief The value stored in a slot of a PropertyHistory, for other types.
+		 *
+		 * The slot shares the immutable snapshot already made by PropertyValue, so recording
+		 * a change does not copy the value. Once written, the slot always holds a snapshot, so
+		 * get() may only be called on a slot whose entry was completed.
+		 */
+		template<typename T>
+		class PropertyHistorySlot<T, false> {
+			private:
+				boost::shared_ptr<const T> snapshot;
+			public:
+				void put(const boost::shared_ptr<const T>& value) {
+					boost::atomic_store(&snapshot, value);
+				}
+
+				T get() const {
+					return *boost::atomic_load(&snapshot);
+				}
+		};
+
+		/**
+		 * \brief A fixed size ring buffer of the last changes of a property.
+		 *
+		 * Enabled per property with PropertyCore::enableHistory(). The ring is allocated once;
+		 * recording a change does not allocate. Changes are recorded by the writer of the property
+		 * while it holds the writer lock of the value, so the order of the entries is the order
+		 * of the writes. Readers never block writers: every slot is guarded by a sequence
+		 * number, and entries overwritten while being read are skipped.
+		 */
+		template<typename T>
+		class PropertyHistory : public PropertyHistoryBase {
+			private:
+				/**
+				 * \internal
+				 * A slot of the ring.
+				 */
+				struct Slot {
+					/**
+					 * Odd while the slot is written, 2 * (index + 1) once entry number index is complete.
+					 */
+					std::atomic<unsigned long> seq;
+
+					/**
+					 * The time of the change, in ticks of the system clock.
+					 */
+					std::atomic<long long> time;
+
+					/**
+					 * The version after the change.
+					 */
+					std::atomic<unsigned long> version;
+
+					/**
+					 * The value.
+					 */
+					PropertyHistorySlot<T> value;
+				};
+
+				/**
+				 * \internal
+				 * The number of slots.
+				 */
+				std::size_t capacity;
+
+				/**
+				 * \internal
+				 * The slots.
+				 */
+				boost::scoped_array<Slot> slots;
+
+				/**
+				 * \internal
+				 * The number of entries recorded so far.
+				 */
+				std::atomic<unsigned long> head;
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyHistory(const PropertyHistory& other) = delete;
+
+				/**
+				 * Constructs an empty history.
+				 * \param [in] capacity The number of changes kept. Must be positive.
+				 */
+				explicit PropertyHistory(std::size_t capacity) :
+					capacity(capacity), slots(new Slot[capacity]), head(0) {
+					for(std::size_t i = 0; i < capacity; ++i)
+						slots[i].seq.store(0, std::memory_order_relaxed);
+				}
+
+				/**
+				 * Records a change. Called by the single writer of the property.
+				 * \param [in] version The version after the change.
+				 * \param [in] value The value written (or its snapshot, see PropertyHistorySlot).
+				 */
+				template<class Stored>
+				void record(unsigned long version, const Stored& value) {
+					unsigned long index = head.load(std::memory_order_relaxed);
+					Slot& s = slots[index % capacity];
+					s.seq.store(2 * index + 1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_release);
+					s.time.store(std::chrono::system_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+					s.version.store(version, std::memory_order_relaxed);
+					s.value.put(value);
+					s.seq.store(2 * index + 2, std::memory_order_release);
+					head.store(index + 1, std::memory_order_release);
+				}
+
+				/**
+				 * Getter for the capacity.
+				 * \return The number of changes kept.
+				 */
+				std::size_t getCapacity() const {
+					return capacity;
+				}
+
+				/**
+				 * Getter for the number of changes recorded.
+				 * \return The number of changes recorded since history was enabled, including
+				 * those already overwritten.
+				 */
+				unsigned long getRecorded() const {
+					return head.load(std::memory_order_acquire);
+				}
+
+				/**
+				 * Reads the recorded changes without blocking the writer.
+				 * \return The changes still in the ring, oldest first.
+				 */
+				std::vector<PropertyHistoryEntry<T>> read() const {
+					std::vector<PropertyHistoryEntry<T>> rv;
+					unsigned long end = head.load(std::memory_order_acquire);
+					unsigned long begin = end > capacity ? end - capacity : 0;
+					rv.reserve(end - begin);
+					for(unsigned long i = begin; i < end; ++i) {
+						const Slot& s = slots[i % capacity];
+						if(s.seq.load(std::memory_order_acquire) != 2 * i + 2)
+							continue;
+						std::chrono::system_clock::time_point time(
+						  std::chrono::system_clock::duration(s.time.load(std::memory_order_relaxed)));
+						unsigned long version = s.version.load(std::memory_order_relaxed);
+						T value = s.value.get();
+						std::atomic_thread_fence(std::memory_order_acquire);
+						if(s.seq.load(std::memory_order_relaxed) != 2 * i + 2)
+							continue;
+						PropertyHistoryEntry<T> e = { time, version, std::move(value) };
+						rv.push_back(std::move(e));
+					}
+					return rv;
+				}
+
+				/**
+				 * Writes the recorded changes as text: the name, the version, the time in
+				 * microseconds since the epoch and the value, separated by spaces. Values are
+				 * written with operator<<, or as a question mark if their type has none.
+				 * \param [in] out The stream to write to.
+				 * \param [in] name The name of the property.
+				 */
+				void dump(std::ostream& out, const Glib::ustring& name) const {
+					std::vector<PropertyHistoryEntry<T>> entries = read();
+					for(auto it = entries.begin(); it != entries.end(); ++it) {
+						out << name << ' ' << it->version << ' '
+						    << std::chrono::duration_cast<std::chrono::microseconds>(it->time.time_since_epoch()).count()
+						    << ' ';
+						historyFormat(out, it->value, std::integral_constant<bool, HasOutputOperator<T>::value>());
+						out << '\n';
+					}
+				}
+		};
+	}
+}
+
+#endif
@@ -19,7 +19,10 @@
 #define PROPERTYINTERFACE_H
 
 #include "IdentifiableClass.h"
-#include <boost/signals2.hpp>
+#include "AsyncWrap.h"
+#include "PropertyConnection.h"
+#include "PropertyCoreBase.h"
+#include <boost/signals2/detail/slot_groups.hpp>
 #include <boost/function.hpp>
 #include <glibmm.h>
 
@@ -44,22 +47,53 @@ namespace denprot {
 				 */
 				virtual const Glib::ustring& getName() const = 0;
 
+				/**
+				 * Getter for the number of notifications suppressed because the written value
+				 * was equal to the current one.
+				 * \return The number of suppressed notifications of this Property.
+				 */
+				virtual unsigned long getSuppressedCount() const = 0;
+
+				/**
+				 * Getter for the version of the value. (See PropertyCoreBase::getVersion)
+				 * \return The current version of this Property.
+				 */
+				virtual unsigned long getVersion() const = 0;
+
+				/**
+				 * \internal
+				 * Getter for the type independent part of the core of this Property.
+				 * \return The core referred to by this Property.
+				 */
+				virtual PropertyCoreBase* getCoreBase() const = 0;
+
 				/**
 				 * Connects a new subscriber to this Property. 
 				 * \param [in] f The subscriber method to connect.
 				 * \param [in] pos The connection position. (See boost::signals2::connect_position)
 				 * \return A connection object to make possible disconnection and status checking.
 				 */
-				virtual boost::signals2::connection connect(boost::function<void()> f,
+				virtual PropertyConnection connect(boost::function<void()> f,
 				  boost::signals2::connect_position pos = boost::signals2::at_back) = 0;
 				  
 				/**
 				 * Connects a new subscriber to this Property. 
 				 * \param [in] f The subscriber method to connect.
-				 * \param [in] grp The connection group of the connection. (See boost::signals2 reference)
+				 * \param [in] grp The connection group of the connection. (See PropertySignal)
+				 * \return A connection object to make possible disconnection and status checking.
+				 */
+				virtual PropertyConnection connect(boost::function<void()> f, int grp) = 0;
+
+				/**
+				 * Connects a new subscriber to this Property. Notifications of the same subscriber
+				 * raised by one PropertyTransaction are merged, even across properties.
+				 * \param [in] f The subscriber method to connect.
+				 * \param [in] subscriber The identity of the subscriber. (See SubscriberId)
+				 * \param [in] pos The connection position. (See boost::signals2::connect_position)
 				 * \return A connection object to make possible disconnection and status checking.
 				 */
-				virtual boost::signals2::connection connect(boost::function<void()> f, int grp) = 0;
+				virtual PropertyConnection connect(boost::function<void()> f, SubscriberId subscriber,
+				  boost::signals2::connect_position pos = boost::signals2::at_back) = 0;
 
 				/**
 				 * Connects a new subscriber to this Property. 
@@ -67,7 +101,7 @@ namespace denprot {
 				 * \param [in] f The subscriber method to connect.
 				 * \return A connection object to make possible disconnection and status checking.
 				 */
-				virtual boost::signals2::connection connectLocal(boost::function<void()> f) = 0;
+				virtual PropertyConnection connectLocal(boost::function<void()> f) = 0;
 		};
 	}
 }
@@ -26,14 +26,16 @@
 #include "ValueConvert.h"
 #include <libxml++/libxml++.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/optional.hpp>
 #include <sstream>
+#include <utility>
 
 namespace denprot {
 	namespace config {
 		template<class T>
 		class PropertyParser : public TerminalContext, public denprot::IdentifiableClass {
 			private:
-				boost::shared_ptr<Property<T>> inst;
+				boost::optional<Property<T>> inst;
 				PropertyCollection::Dyn collector;
 	
 				PropertyParser(PropertyCollection::Dyn collector) : collector(collector) {
@@ -93,8 +95,7 @@ namespace denprot {
 					}
 					T q;
 					valueConvert<Glib::ustring, T>(*pValue,q);
-					inst = boost::shared_ptr<Property<T>>(new Property<T>(*pName,q));
-					collector->add(*pName,boost::static_pointer_cast<PropertyInterface>(inst));
+					inst.emplace(collector->newProperty<T>(*pName,std::move(q)));
 				}
 		
 				/**
@@ -24,64 +24,68 @@
 #ifndef DPTCPP_CONFIG_PROPERTYREACTOR_H
 #define DPTCPP_CONFIG_PROPERTYREACTOR_H
 
-#include <boost/asio.hpp>
 #include <boost/thread.hpp>
-#include <boost/thread/barrier.hpp>
 #include <boost/function.hpp>
 
+#include "Reactor.h"
+
 namespace denprot {
 	namespace config {
 
 		/**
-		 * PropertyReactor represents a separate thread of execution responsible 
+		 * PropertyReactor represents a pool of threads of execution responsible
 		 * for running functions of property subscribers separated from the context
 		 * in which the property was modified.
 		 * A class encapsulating a boost proactor/reactor pattern implementation
+		 *
+		 * Functions are posted with an ordering key (see post(boost::function<void()>, const void*)):
+		 * functions with the same key run in the order they were posted and never concurrently,
+		 * functions with different keys may run in parallel on different threads. Keys are
+		 * mapped to a fixed set of queues by their hash, so unrelated keys may share a queue.
+		 * A reactor started with one thread has a single queue per priority class, running
+		 * every function of a class in the order it was posted.
+		 *
+		 * The functions are run by a ReactorBackend chosen when the reactor is started.
+		 *
+		 * The methods of this class control the global Reactor, used by every property not
+		 * bound to a reactor of its own. Its threads are started and joined by the replaceable
+		 * starter and killer algorithms.
 		 */
 		class PropertyReactor {
 			public:
 				typedef void(*ThreadStarter)(void(*handler)(void*));
 				typedef void(*ThreadKiller)();
-			private:
+
 				/**
-				 * \internal
-				 * \brief The reactor object.
-				 */
-				static boost::asio::io_service reactor;
-				
-				/** 
-				 * \internal
-				 * \brief The strand used for keeping the order of handlers in the reactor
+				 * The executors a reactor can run on. (See Reactor::Backend)
 				 */
-				static boost::asio::io_service::strand* strand;
-		
+				typedef Reactor::Backend Backend;
+
 				/**
-				 * \internal
-				 * \brief The thread running the reactor.
+				 * (See Reactor::Asio)
 				 */
-				static boost::thread* thread;
-		
+				static const Backend Asio = Reactor::Asio;
+
 				/**
-				 * \internal
-				 * \brief A work object keeping the reactor alive until execution
-				 * of the application stops.
+				 * (See Reactor::WorkStealing)
 				 */
-				static boost::asio::io_service::work* keeper;
-				
+				static const Backend WorkStealing = Reactor::WorkStealing;
+			private:
 				/**
 				 * \internal
-				 * \brief Barrier helping synchronization of one other thread with the reactor.
+				 * \brief The global reactor.
 				 */
-				static boost::barrier* syncer;
-				
+				static Reactor* reactor;
+		
 				/**
 				 * \internal
-				 * \brief True when the reactor should collapse as the program finishes
+				 * \brief The threads started by the default starter.
 				 */
-				static bool quit;
+				static boost::thread_group* threads;
+
 				/**
 				 * \internal
-				 * This is the method ran by the thread, starting the reactor.
+				 * This is the method ran by the threads, starting the reactor.
 				 * The void* argument is ignored.
 				 */
 				static void handler(void*);
@@ -104,6 +108,26 @@ namespace denprot {
 				 * (and as a consequence, starting the reactor itself)
 				 */
 				static void start();
+
+				/**
+				 * Starts the reactor on a pool of threads.
+				 * \param [in] threads The number of threads. Must be positive.
+				 * \param [in] kind The executor to run the functions on.
+				 * \throw Exception If threads is 0 or the reactor is already started.
+				 */
+				static void start(unsigned threads, Backend kind = Asio);
+
+				/**
+				 * Getter for the number of threads of the reactor.
+				 * \return The number of threads the reactor was started with.
+				 */
+				static unsigned getThreadCount();
+
+				/**
+				 * Getter for the metrics of the reactor. (See Reactor::getMetrics)
+				 * \return The metrics, kept while the reactor is stopped and started again.
+				 */
+				static ReactorMetrics& getMetrics();
 		
 				/**
 				 * This method is responsible for dropping the work object which keeps the
@@ -115,26 +139,57 @@ namespace denprot {
 				static void stop();
 				
 				/**
-				 * Makes it possible for a thread to catch up with the reactor thread resulting in
+				 * Makes it possible for a thread to catch up with the reactor threads resulting in
 				 * a state in which it is guaranteed for that thread that a reactor is in a certain
 				 * state.
 				 */
 				static void sync();
+
+				/**
+				 * Waits until the reactor ran every function posted before the call, without waiting
+				 * for the functions posted later. (See Reactor::flush)
+				 */
+				static void flush();
 		
 				/**
-				 * Dispatches a function to the reactor making it execute it on the
-				 * reactor thread.
+				 * Dispatches a function to the reactor making it execute it on a
+				 * reactor thread, in the order of the functions posted without a key.
 				 * \param [in] func The function to run in the reactor.
 				 */
 				static void post(boost::function<void()> func);
+
+				/**
+				 * Dispatches a function to the reactor making it execute it on a
+				 * reactor thread, after the functions posted earlier with the same key.
+				 * \param [in] func The function to run in the reactor.
+				 * \param [in] key The ordering key, usually the address of a property or subscriber.
+				 * \param [in] priority The priority class of the function. The functions of a higher
+				 * class run before any queued function of a lower class.
+				 */
+				static void post(boost::function<void()> func, const void* key,
+				                 Priority::Class priority = Priority::Normal);
+
+				/**
+				 * Dispatches a function like post(), unless the reactor is not started. (See Reactor::tryPost)
+				 * \param [in] func The function to run in the reactor.
+				 * \param [in] key The ordering key.
+				 * \param [in] priority The priority class of the function.
+				 * \param [in] source The identity of the function in the slow callback reports, NULL for
+				 * the ordering key. (See SlowCallback::source)
+				 * \return False if the reactor is not started and the function was not posted.
+				 */
+				static bool tryPost(const boost::function<void()>& func, const void* key,
+				                    Priority::Class priority = Priority::Normal, const void* source = NULL);
 				
 				/**
-				 * The threadstarter algorithm used for starting the reactor thread
+				 * The threadstarter algorithm used for starting a reactor thread. It is
+				 * called once per thread.
 				 */
 				static ThreadStarter starter;
 				
 				/**
-				 * The threadkiller algorithm used for joining the reactor thread
+				 * The threadkiller algorithm used for joining the reactor threads. It is
+				 * called once, and must join every thread started by the starter.
 				 */
 				static ThreadKiller killer;
 		};
@@ -0,0 +1,28 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DPTCPP_CONFIG_PROPERTYREADONLY_FWD_H
+#define DPTCPP_CONFIG_PROPERTYREADONLY_FWD_H
+
+namespace denprot {
+	namespace config {
+		template <class T>
+		class PropertyReadOnly;
+	}
+}
+
+#endif
@@ -23,13 +23,15 @@
 #ifndef DPTCPP_CONFIG_PROPERTYREADONLY_H
 #define DPTCPP_CONFIG_PROPERTYREADONLY_H
 
-#include <boost/shared_ptr.hpp>
-#include <boost/signals2.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/signals2/detail/slot_groups.hpp>
 #include <boost/function.hpp>
 #include <glibmm.h>
 
 #include "PropertyCore.h"
+#include "Reactor.h"
 #include "PropertyWeak-fwd.h"
+#include "PropertyReadOnly-fwd.h"
 #include "PropertyInterface.h"
 #include "Property.h"
 
@@ -38,18 +40,28 @@ namespace denprot {
 
 /**
  * \brief PropertyReadOnly template class capable of representing a read-only property of an arbitary type.
+ *
+ * Like Property, a PropertyReadOnly is a handle consisting of a single intrusive pointer.
  */
 template<typename T>
 class PropertyReadOnly : public denprot::config::PropertyInterface {
 	public:
 		friend class PropertyWeak<T>;
 		/**
-		 * Helper to refer to a non-copyable PropertyCore object using shared pointers. This is used mainly internally.
+		 * Helper to refer to a non-copyable PropertyCore object using intrusive pointers. This is used mainly internally.
+		 */
+		typedef boost::intrusive_ptr<PropertyCore<T>> PropertyCoreDyn;
+
+		/**
+		 * The type returned by getValue(). (See PropertyCore::ReadType)
 		 */
-		typedef boost::shared_ptr<PropertyCore<T>> PropertyCoreDyn;
-		typedef Property<T> Property;
-		friend class Property;
-	private:
+		typedef typename PropertyCore<T>::ReadType ReadType;
+
+		/**
+		 * An immutable snapshot of the value. (See PropertyCore::Snapshot)
+		 */
+		typedef typename PropertyCore<T>::Snapshot Snapshot;
+	protected:
 	
 		/**
 		 * \internal
@@ -58,18 +70,12 @@ class PropertyReadOnly : public denprot::config::PropertyInterface {
 		 * The core is responsible for storing the value itself
 		 */
 		PropertyCoreDyn prop;
-		
-		unsigned* refCnt;
-		
-		boost::mutex* mut;
-		
-		PropertyReadOnly(PropertyCoreDyn prop, unsigned* refCnt, boost::mutex* mut) {
-			mut->lock();
-			this->mut = mut;
-			this->prop = prop;
-			this->refCnt = refCnt;
-			++(*refCnt);
-			mut->unlock();
+
+		/**
+		 * \internal
+		 * Constructs a PropertyReadOnly referring to an already existing core.
+		 */
+		explicit PropertyReadOnly(const PropertyCoreDyn& prop) : prop(prop) {
 		}
 	public:
 		
@@ -77,7 +83,7 @@ class PropertyReadOnly : public denprot::config::PropertyInterface {
 		 * \brief Experimental empty constructor
 		 */
 		PropertyReadOnly() :
-			prop(new PropertyCore<T>()), refCnt(new unsigned(1)), mut(new boost::mutex()) {
+			prop(new PropertyCore<T>()) {
 		}
 	
 		/**
@@ -88,33 +94,26 @@ class PropertyReadOnly : public denprot::config::PropertyInterface {
 		 * functions connected to the changed signal. (You write code which copies by value, of course)
 		 * \param [in] p The property which should be copied
 		 */
-		PropertyReadOnly(const PropertyReadOnly& p) {
-			p.mut->lock();
-			prop = p.prop;
-			mut = p.mut;
-			refCnt = p.refCnt;
-			++(*refCnt);
-			p.mut->unlock();
+		PropertyReadOnly(const PropertyReadOnly& p) : prop(p.prop) {
+		}
+
+		/**
+		 * \brief Move-constructor for a property.
+		 *
+		 * The moved-from PropertyReadOnly may only be destroyed or rebound with operator*=.
+		 * \param [in] p The property which should be moved
+		 */
+		PropertyReadOnly(PropertyReadOnly&& p) noexcept : prop(std::move(p.prop)) {
 		}
 
-		PropertyReadOnly(const Property<T>& p) {
-			p.mut->lock();
-			prop = p.prop;
-			mut = p.mut;
-			refCnt = p.refCnt;
-			++(*refCnt);
-			p.mut->unlock();
+		/**
+		 * \brief Constructs a read-only view of a Property, sharing its core.
+		 * \param [in] p The property to refer to
+		 */
+		PropertyReadOnly(const Property<T>& p) : prop(p.prop) {
 		}
 		
 		~PropertyReadOnly() {
-			mut->lock();
-			--(*refCnt);
-			if(*refCnt == 0) {
-				delete refCnt;
-				mut->unlock();
-				delete mut;
-			} else
-				mut->unlock();
 		}
 		
 		/**
@@ -124,24 +123,17 @@ class PropertyReadOnly : public denprot::config::PropertyInterface {
 		 * \return A reference to this PropertyReadOnly.
 		 */
 		PropertyReadOnly<T>& operator*=(const PropertyReadOnly<T>& other) {
-			// If other refers to a different PropertyCore
-			if(refCnt != other.refCnt) {
-				mut->lock();
-				--(*refCnt);
-				if(*refCnt == 0) {
-					delete refCnt;
-					mut->unlock();
-					delete mut;
-				} else
-					mut->unlock();
-			
-				other.mut->lock();
-				mut = other.mut;
-				refCnt = other.refCnt;
-				++(*refCnt);
-				prop = other.prop;
-				other.mut->unlock();
-			}
+			prop = other.prop;
+			return *this;
+		}
+
+		/**
+		 * Changes the PropertyCore to which this PropertyReadOnly refers to, taking over the reference of other.
+		 * \param [in] The PropertyReadOnly whose core should be referenced by this PropertyReadOnly instance.
+		 * \return A reference to this PropertyReadOnly.
+		 */
+		PropertyReadOnly<T>& operator*=(PropertyReadOnly<T>&& other) noexcept {
+			prop = std::move(other.prop);
 			return *this;
 		}
 
@@ -151,25 +143,8 @@ class PropertyReadOnly : public denprot::config::PropertyInterface {
 		 * \param [in] The Property whose core should be referenced by this PropertyReadOnly instance.
 		 * \return A reference to this PropertyReadOnly.
 		 */
-		PropertyReadOnly<T>& operator*=(const Property& other) {
-			// If other refers to a different PropertyCore
-			if(refCnt != other.refCnt) {
-				mut->lock();
-				--(*refCnt);
-				if(*refCnt == 0) {
-					delete refCnt;
-					mut->unlock();
-					delete mut;
-				} else
-					mut->unlock();
-			
-				other.mut->lock();
-				mut = other.mut;
-				refCnt = other.refCnt;
-				++(*refCnt);
-				prop = other.prop;
-				other.mut->unlock();
-			}
+		PropertyReadOnly<T>& operator*=(const Property<T>& other) {
+			prop = other.prop;
 			return *this;
 		}
 		
@@ -193,17 +168,86 @@ class PropertyReadOnly : public denprot::config::PropertyInterface {
 		 * Getter for the value of the PropertyReadOnly.
 		 * \return The value of this PropertyReadOnly.
 		 */
-		const T& getValue() const {
+		ReadType getValue() const {
 			return prop->getValue();
 		}
+
+		/**
+		 * Takes an immutable snapshot of the value of the PropertyReadOnly.
+		 * \return The current snapshot of the value.
+		 */
+		Snapshot getSnapshot() const {
+			return prop->getSnapshot();
+		}
+
+		/**
+		 * Getter for the number of notifications suppressed because the written value
+		 * was equal to the current one. (See PropertyCompare)
+		 * \return The number of suppressed notifications of this PropertyReadOnly.
+		 */
+		unsigned long getSuppressedCount() const {
+			return prop->getSuppressedCount();
+		}
+
+		/**
+		 * Binds this PropertyReadOnly to a reactor: the asynchronous subscribers connected afterwards
+		 * run in it instead of the global PropertyReactor. (See Reactor)
+		 * \param [in] reactor The reactor, or an empty pointer for the global one.
+		 */
+		void setReactor(const boost::shared_ptr<Reactor>& reactor) {
+			prop->setReactor(reactor);
+		}
+
+		/**
+		 * Getter for the reactor of this PropertyReadOnly.
+		 * \return The reactor bound with setReactor(), or an empty pointer for the global one.
+		 */
+		boost::shared_ptr<Reactor> getReactor() const {
+			return prop->getReactor();
+		}
+
+		/**
+		 * Getter for the version of the value. It grows on every change, so a reader may cache
+		 * what it derived from the value and only read it again when the version differs.
+		 * (See PropertyCoreBase::getVersion)
+		 * \return The current version of this PropertyReadOnly.
+		 */
+		unsigned long getVersion() const {
+			return prop->getVersion();
+		}
+
+		/**
+		 * Starts recording the changes of the value. (See PropertyCore::enableHistory)
+		 * \param [in] capacity The number of changes kept.
+		 */
+		void enableHistory(std::size_t capacity) {
+			prop->enableHistory(capacity);
+		}
+
+		/**
+		 * Reads the recorded changes of the value. (See PropertyHistory)
+		 * \return The changes still kept, oldest first. Empty if history is not enabled.
+		 */
+		std::vector<PropertyHistoryEntry<T>> getHistory() const {
+			return prop->getHistory();
+		}
+
+		/**
+		 * \internal
+		 * Getter for the type independent part of the core of this PropertyReadOnly.
+		 * \return The core referred to by this PropertyReadOnly.
+		 */
+		PropertyCoreBase* getCoreBase() const {
+			return prop.get();
+		}
 		
 		/**
 		 * Connects a new subscriber to this PropertyReadOnly. 
 		 * \param [in] f The subscriber method to connect.
-		 * \param [in] grp The connection group of the connection. (See boost::signals2 reference)
+		 * \param [in] grp The connection group of the connection. (See PropertySignal)
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connect(boost::function<void()> f, int grp) {
+		PropertyConnection connect(boost::function<void()> f, int grp) {
 			return prop->connect(f, grp);
 		}
 
@@ -213,19 +257,60 @@ class PropertyReadOnly : public denprot::config::PropertyInterface {
 		 * \param [in] pos The connection position of the connection. (See boost::signals2::connect_position)
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connect(boost::function<void()> f,
+		PropertyConnection connect(boost::function<void()> f,
 		  boost::signals2::connect_position pos = boost::signals2::at_back) {
 			return prop->connect(f,pos);
 		}
 		
+		/**
+		 * Connects a new subscriber to this PropertyReadOnly. Notifications of the same subscriber
+		 * raised by one PropertyTransaction are merged, even across properties.
+		 * \param [in] f The subscriber method to connect.
+		 * \param [in] subscriber The identity of the subscriber. (See SubscriberId)
+		 * \param [in] pos The boost::connect_position of the connection. Default is at_back. 
+		 * \return A connection object to make possible disconnection and status checking.
+		 */
+		PropertyConnection connect(boost::function<void()> f, SubscriberId subscriber,
+		  boost::signals2::connect_position pos = boost::signals2::at_back) {
+			return prop->connect(f,subscriber,pos);
+		}
+
+		/**
+		 * Connects a new subscriber to this PropertyReadOnly, with the notifications queued in a given
+		 * priority class of the reactor: they run before any queued notification of a lower class.
+		 * \param [in] f The subscriber method to connect.
+		 * \param [in] priority The priority class of the notifications. (See Priority)
+		 * \param [in] subscriber The identity of the subscriber. (See SubscriberId)
+		 * \return A connection object to make possible disconnection and status checking.
+		 */
+		PropertyConnection connect(boost::function<void()> f, Priority::Class priority,
+		  SubscriberId subscriber = NULL) {
+			return prop->connect(f,priority,subscriber);
+		}
+		
+		/**
+		 * Connects a new subscriber to this PropertyReadOnly. 
+		 * The connected function will run on the thread changing the property's value.
+		 * \param [in] f The subscriber method to connect.
+		 * \return A connection object to make possible disconnection and status checking.
+		 */
+		PropertyConnection connectLocal(boost::function<void()> f) {
+			return prop->connectLocal(f);
+		}
+		
 		/**
 		 * Connects a new subscriber to this PropertyReadOnly. The subscriber will always receive
 		 * a valid reference to the PropertyReadOnly which just changed.
 		 * \param [in] f The subscriber method to connect.
 		 * \return A connection object to make possible disconnection and status checking.
 		 */
-		boost::signals2::connection connect(boost::function<void(PropertyReadOnly<T>&)> f) {
-			return prop->connect(*this,boost::function<void(PropertyReadOnly<T>&)>(f));
+		PropertyConnection connect(boost::function<void(PropertyReadOnly<T>&)> f) {
+			Property<T> p(prop);
+			auto wrap = [f](Property<T>& q) {
+				PropertyReadOnly<T> ro(q);
+				f(ro);
+			};
+			return prop->connect(p, boost::function<void(Property<T>&)>(wrap), boost::signals2::at_back);
 		}
 };
 
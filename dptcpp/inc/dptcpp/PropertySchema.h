@@ -0,0 +1,273 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertySchema.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertySchema template class and the DPTCPP_PROPERTY macro.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYSCHEMA_H
+#define DPTCPP_CONFIG_PROPERTYSCHEMA_H
+
+#include <boost/shared_ptr.hpp>
+#include <glibmm.h>
+#include <tuple>
+#include <map>
+#include <sstream>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "Property.h"
+#include "PropertyCollection.h"
+#include "Exception.h"
+#include "ValueConvert.h"
+
+/**
+ * Declares a key of a PropertySchema: a type naming a property, its value type, its name
+ * in configuration files and its default value.
+ * \param Key The name of the declared key type.
+ * \param T The value type of the property.
+ * \param keyName The name of the property, a string literal.
+ * \param def The default value, converted to T.
+ */
+#define DPTCPP_PROPERTY(Key, T, keyName, def) \
+	struct Key { \
+		typedef T Type; \
+		static const char* name() { \
+			return keyName; \
+		} \
+		static Type defaultValue() { \
+			return Type(def); \
+		} \
+	}
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \internal
+		 * The position of Key in Keys, computed at compile time.
+		 */
+		template<class Key, class... Keys>
+		struct PropertySchemaIndex;
+
+		/**
+		 * \internal
+		 * The key is found.
+		 */
+		template<class Key, class... Rest>
+		struct PropertySchemaIndex<Key, Key, Rest...> : std::integral_constant<std::size_t, 0> {
+		};
+
+		/**
+		 * \internal
+		 * The key is searched for in the rest.
+		 */
+		template<class Key, class First, class... Rest>
+		struct PropertySchemaIndex<Key, First, Rest...> :
+			std::integral_constant<std::size_t, 1 + PropertySchemaIndex<Key, Rest...>::value> {
+		};
+
+		/**
+		 * \internal
+		 * The key is not part of the schema.
+		 */
+		template<class Key>
+		struct PropertySchemaIndex<Key> : std::integral_constant<std::size_t, 0> {
+			static_assert(sizeof(Key) == 0, "The key is not part of this PropertySchema");
+		};
+
+		/**
+		 * \brief A set of properties declared at compile time.
+		 *
+		 * Every key (see DPTCPP_PROPERTY) names one property of the schema. The properties are
+		 * stored in a tuple, so get<Key>() is resolved to a fixed slot by the compiler: no name
+		 * lookup, no type check and no copy of the handle at run time, and asking for a key
+		 * which is not part of the schema does not compile. The properties are created with
+		 * their default values.
+		 *
+		 * Like Property, a PropertySchema is a set of handles: copies share the properties.
+		 * Configuration files are loaded into a schema with SchemaParseContext.
+		 */
+		template<class... Keys>
+		class PropertySchema {
+			static_assert(sizeof...(Keys) > 0, "A PropertySchema must have at least one key");
+			public:
+				typedef boost::shared_ptr<PropertySchema<Keys...>> Dyn;
+
+				/**
+				 * The number of keys.
+				 */
+				static const std::size_t Size = sizeof...(Keys);
+			private:
+				/**
+				 * \internal
+				 * The properties, in the order of the keys.
+				 */
+				std::tuple<Property<typename Keys::Type>...> props;
+
+				/**
+				 * \internal
+				 * Converts a text to the type of Key and writes it to the property.
+				 */
+				template<class Key>
+				static void parseKey(PropertySchema& schema, const Glib::ustring& text) {
+					typename Key::Type value;
+					valueConvert<Glib::ustring, typename Key::Type>(text, value);
+					schema.get<Key>().setValue(std::move(value));
+				}
+
+				/**
+				 * \internal
+				 * Adds the properties from Index to the end to a collection.
+				 */
+				template<std::size_t Index>
+				typename std::enable_if<Index < Size>::type addFrom(PropertyCollection& collection) const {
+					typedef typename std::tuple_element<Index, decltype(props)>::type P;
+					const P& p = std::get<Index>(props);
+					collection.add(p.getName(), PropertyInterface::Dyn(new P(p)));
+					addFrom<Index + 1>(collection);
+				}
+
+				/**
+				 * \internal
+				 * The end of the recursion.
+				 */
+				template<std::size_t Index>
+				typename std::enable_if<Index == Size>::type addFrom(PropertyCollection& collection) const {
+				}
+
+				/**
+				 * \internal
+				 * The keys by their names.
+				 */
+				static const std::map<Glib::ustring, std::size_t>& nameIndex() {
+					static const std::map<Glib::ustring, std::size_t> index = buildNameIndex();
+					return index;
+				}
+
+				/**
+				 * \internal
+				 * Builds the index of nameIndex().
+				 */
+				static std::map<Glib::ustring, std::size_t> buildNameIndex() {
+					std::map<Glib::ustring, std::size_t> index;
+					for(std::size_t i = 0; i < Size; ++i) {
+						if(!index.insert(std::make_pair(Glib::ustring(getName(i)), i)).second) {
+							std::stringstream strm;
+							strm << "Property name '" << getName(i) << "' is used by more than one key of the PropertySchema";
+							throw Exception(strm.str().c_str(),CodePos);
+						}
+					}
+					return index;
+				}
+			public:
+				/**
+				 * Creates the properties of the schema with their default values.
+				 */
+				PropertySchema() :
+					props(Property<typename Keys::Type>(Keys::name(), Keys::defaultValue())...) {
+				}
+
+				/**
+				 * Getter for the property of a key.
+				 * \return The property of Key, referring to a slot of the schema.
+				 */
+				template<class Key>
+				Property<typename Key::Type>& get() {
+					return std::get<PropertySchemaIndex<Key, Keys...>::value>(props);
+				}
+
+				/**
+				 * Getter for the property of a key.
+				 * \return The property of Key, referring to a slot of the schema.
+				 */
+				template<class Key>
+				const Property<typename Key::Type>& get() const {
+					return std::get<PropertySchemaIndex<Key, Keys...>::value>(props);
+				}
+
+				/**
+				 * Getter for the value of a key. (See Property::getValue)
+				 * \return The current value of the property of Key.
+				 */
+				template<class Key>
+				typename Property<typename Key::Type>::ReadType getValue() const {
+					return get<Key>().getValue();
+				}
+
+				/**
+				 * Getter for the index of a key.
+				 * \return The position of Key in the schema.
+				 */
+				template<class Key>
+				static std::size_t indexOf() {
+					return PropertySchemaIndex<Key, Keys...>::value;
+				}
+
+				/**
+				 * Finds a key by the name of its property.
+				 * \param [in] name The name of the property.
+				 * \return The index of the key, or Size if no key has this name.
+				 * \throw Exception If two keys of the schema have the same name.
+				 */
+				static std::size_t find(const Glib::ustring& name) {
+					const std::map<Glib::ustring, std::size_t>& index = nameIndex();
+					auto it = index.find(name);
+					return it == index.end() ? Size : it->second;
+				}
+
+				/**
+				 * Getter for the name of a key.
+				 * \param [in] index The index of the key. Must be less than Size.
+				 * \return The name of the property of the key.
+				 */
+				static const char* getName(std::size_t index) {
+					static const char* const names[] = { Keys::name()... };
+					return names[index];
+				}
+
+				/**
+				 * Converts a text to the type of a key and writes it to its property. (See valueConvert)
+				 * \param [in] index The index of the key. Must be less than Size.
+				 * \param [in] text The text to convert.
+				 * \throw Exception If the text can not be converted.
+				 */
+				void parse(std::size_t index, const Glib::ustring& text) {
+					static void (*const parsers[])(PropertySchema&, const Glib::ustring&) = {
+						&PropertySchema::template parseKey<Keys>...
+					};
+					parsers[index](*this, text);
+				}
+
+				/**
+				 * Adds every property of the schema to a collection, for code looking them up by name.
+				 * \param [in] collection The collection to add to.
+				 * \throw Exception If a property with the same name is already in the collection, or if
+				 * the properties are already in a collection.
+				 */
+				void addTo(PropertyCollection& collection) const {
+					addFrom<0>(collection);
+				}
+		};
+
+		template<class... Keys>
+		const std::size_t PropertySchema<Keys...>::Size;
+	}
+}
+
+#endif
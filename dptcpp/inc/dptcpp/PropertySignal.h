@@ -0,0 +1,415 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertySignal.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertySignal class.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYSIGNAL_H
+#define DPTCPP_CONFIG_PROPERTYSIGNAL_H
+
+#include <boost/signals2/detail/slot_groups.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <new>
+#include <atomic>
+#include <cstdint>
+
+#include "PropertyConnection.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief The changed signal of a PropertyCore.
+		 *
+		 * The connected slots are kept in an immutable array which is replaced as a whole when
+		 * a slot is connected (copy-on-write), so emission never locks and never allocates.
+		 * The array is reclaimed with differential reference counting: the published word holds
+		 * the pointer of the array together with the number of emissions that picked it up, so
+		 * an emission costs one atomic increment of the word and one atomic decrement of the
+		 * array. When the array is replaced the number of pick-ups is transferred to the array,
+		 * which is freed by whoever drops the last reference.
+		 * If an array is ever allocated at an address which does not fit into the pointer bits of
+		 * the word, the signal falls back to publishing the pointer unpacked, and emissions pick it
+		 * up under the writer mutex instead.
+		 *
+		 * Ordering follows boost::signals2: ungrouped slots connected at the front, then the
+		 * groups in ascending order, then ungrouped slots connected at the back.
+		 * Disconnection flags the slot, so emissions starting afterwards skip it. Flagged slots
+		 * are dropped from the array by the next connect(), or by the disconnection which makes
+		 * them more than a PruneRatio-th of the array.
+		 */
+		class PropertySignal : private PropertySlotOwner {
+			public:
+				/**
+				 * The array is compacted once more than one in PruneRatio of its slots is disconnected.
+				 */
+				static const std::size_t PruneRatio = 4;
+			private:
+				/**
+				 * \internal
+				 * An immutable array of slots.
+				 */
+				struct SlotArray {
+					/**
+					 * The references of the array. See Owned.
+					 */
+					std::atomic<long long> refs;
+
+					/**
+					 * The slots in emission order.
+					 */
+					std::vector<boost::shared_ptr<PropertySlot>> slots;
+				};
+
+				/**
+				 * \internal
+				 * The number of low bits of the word holding the pointer. The rest counts pick-ups.
+				 * On 64 bit platforms user space addresses usually fit into 48 bits. Checked by
+				 * publish(), see wide.
+				 */
+				static const unsigned PtrBits = sizeof(void*) == 8 ? 48 : 32;
+
+				/**
+				 * \internal
+				 * One pick-up in the word.
+				 */
+				static const std::uint64_t One = std::uint64_t(1) << PtrBits;
+
+				/**
+				 * \internal
+				 * The number of pick-ups after which they are transferred to the array, well
+				 * below the capacity of the counter bits.
+				 */
+				static const std::uint64_t FoldAt = std::uint64_t(1) << (64 - PtrBits - 2);
+
+				/**
+				 * \internal
+				 * The reference held by the word while the array is published. It is larger than
+				 * any possible number of concurrent emissions, so the count of a published array
+				 * never reaches zero.
+				 */
+				static const long long Owned = 1LL << 40;
+
+				/**
+				 * \internal
+				 * The published array and the number of pick-ups. A NULL array means no slots.
+				 */
+				std::atomic<std::uint64_t> word;
+
+				/**
+				 * \internal
+				 * True once an array did not fit into the word (5-level paging, tagged pointers).
+				 * The array is then published in widePtr and the word stays NULL. Never reset.
+				 */
+				std::atomic<bool> wide;
+
+				/**
+				 * \internal
+				 * The published array if wide is true. Guarded by writer.
+				 */
+				SlotArray* widePtr;
+
+				/**
+				 * \internal
+				 * The mutex serializing the modifications of the array.
+				 */
+				boost::mutex writer;
+
+				/**
+				 * \internal
+				 * The link given to the slots, created by the first connect(). Guarded by writer.
+				 */
+				boost::shared_ptr<PropertySlotLink> link;
+
+				/**
+				 * \internal
+				 * The number of slots disconnected since the array was last rebuilt. Guarded by writer.
+				 */
+				std::size_t dead;
+
+				/**
+				 * \internal
+				 * Extracts the array of a word.
+				 */
+				static SlotArray* arrayOf(std::uint64_t w) {
+					return reinterpret_cast<SlotArray*>(static_cast<std::uintptr_t>(w & (One - 1)));
+				}
+
+				/**
+				 * \internal
+				 * Drops a reference of an array, freeing it if it was the last one.
+				 */
+				static void release(SlotArray* array, long long n) {
+					if(array && array->refs.fetch_sub(n, std::memory_order_acq_rel) == n)
+						delete array;
+				}
+
+				/**
+				 * \internal
+				 * Transfers the pick-ups counted in the word to the array. The array is credited
+				 * before the word is cleared, so a concurrent publish() can never see it unreferenced.
+				 */
+				void fold(SlotArray* array, std::uint64_t w) {
+					for(;;) {
+						long long n = static_cast<long long>(w >> PtrBits);
+						array->refs.fetch_add(n, std::memory_order_relaxed);
+						if(word.compare_exchange_weak(w, w & (One - 1), std::memory_order_acq_rel,
+						                              std::memory_order_relaxed))
+							return;
+						release(array, n);
+						if(arrayOf(w) != array || (w >> PtrBits) < FoldAt)
+							return;
+					}
+				}
+
+				/**
+				 * \internal
+				 * Picks up the published array for an emission. Wait-free except for the
+				 * transfer of the pick-ups made once in every FoldAt emissions, unless the
+				 * signal fell back to the unpacked pointer.
+				 */
+				SlotArray* acquire() {
+					std::uint64_t w = word.fetch_add(One, std::memory_order_acquire) + One;
+					SlotArray* array = arrayOf(w);
+					if(array) {
+						if((w >> PtrBits) >= FoldAt)
+							fold(array, w);
+						return array;
+					}
+					// Set before the word is cleared by the fallback, so a NULL word read after it is seen.
+					if(!wide.load(std::memory_order_acquire))
+						return NULL;
+					boost::lock_guard<boost::mutex> lck(writer);
+					if(widePtr)
+						widePtr->refs.fetch_add(1, std::memory_order_relaxed);
+					return widePtr;
+				}
+
+				/**
+				 * \internal
+				 * Getter for the published array. The caller must hold the writer mutex.
+				 */
+				SlotArray* current() const {
+					return wide.load(std::memory_order_relaxed) ? widePtr : arrayOf(word.load(std::memory_order_relaxed));
+				}
+
+				/**
+				 * \internal
+				 * A replaced array whose reference is dropped when the holder goes out of scope.
+				 * Declared before the lock of the writer mutex, so that freeing the array, and the
+				 * slot functions only it references, happens after the mutex is released.
+				 */
+				struct Retired {
+					SlotArray* array;
+					long long refs;
+					~Retired() {
+						release(array, refs);
+					}
+				};
+
+				/**
+				 * \internal
+				 * Publishes a new array, handing the reference of the previous one to retired.
+				 * The caller must hold the writer mutex, and retired must not hold an array yet.
+				 */
+				void publish(SlotArray* next, Retired& retired) {
+					std::uintptr_t p = reinterpret_cast<std::uintptr_t>(next);
+					if(next)
+						next->refs.store(Owned, std::memory_order_relaxed);
+					if(!wide.load(std::memory_order_relaxed) && (static_cast<std::uint64_t>(p) & ~(One - 1)) == 0) {
+						std::uint64_t old = word.exchange(static_cast<std::uint64_t>(p), std::memory_order_acq_rel);
+						retired.array = arrayOf(old);
+						retired.refs = Owned - static_cast<long long>(old >> PtrBits);
+						return;
+					}
+					if(!wide.load(std::memory_order_relaxed)) {
+						// Emissions picking up the packed array keep counting in the word until
+						// it is cleared, so the array is retired from there.
+						widePtr = next;
+						wide.store(true, std::memory_order_release);
+						std::uint64_t old = word.exchange(0, std::memory_order_acq_rel);
+						retired.array = arrayOf(old);
+						retired.refs = Owned - static_cast<long long>(old >> PtrBits);
+						return;
+					}
+					retired.array = widePtr;
+					retired.refs = Owned;
+					widePtr = next;
+				}
+
+				/**
+				 * \internal
+				 * Drops the reference of an emission even if a slot throws.
+				 */
+				struct Emission {
+					SlotArray* array;
+					~Emission() {
+						release(array, 1);
+					}
+				};
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertySignal(const PropertySignal& other) = delete;
+
+				/**
+				 * Constructs a signal without slots.
+				 */
+				PropertySignal() : word(0), wide(false), widePtr(NULL), dead(0) {
+				}
+
+				/**
+				 * Drops the slots.
+				 */
+				~PropertySignal() {
+					if(link) {
+						boost::lock_guard<boost::mutex> lck(link->lock);
+						link->owner = NULL;
+					}
+					Retired retired = { NULL, 0 };
+					publish(NULL, retired);
+				}
+
+				/**
+				 * Calls the connected slots. Does not lock and does not allocate.
+				 */
+				void operator()() {
+					Emission e = { acquire() };
+					if(!e.array)
+						return;
+					for(auto it = e.array->slots.begin(); it != e.array->slots.end(); ++it) {
+						if((*it)->connected.load(std::memory_order_acquire))
+							(*it)->func();
+					}
+				}
+
+				/**
+				 * Connects an ungrouped slot.
+				 * \param [in] func The function to connect.
+				 * \param [in] pos The position of the connection. (See boost::signals2::connect_position)
+				 * \return The handle of the connection.
+				 */
+				PropertyConnection connect(const boost::function<void()>& func,
+				  boost::signals2::connect_position pos = boost::signals2::at_back) {
+					return insert(func, pos == boost::signals2::at_front ? 0 : 2, 0, pos);
+				}
+
+				/**
+				 * Connects a slot into a group.
+				 * \param [in] group The group of the connection. Groups are called in ascending order.
+				 * \param [in] func The function to connect.
+				 * \param [in] pos The position of the connection inside the group.
+				 * \return The handle of the connection.
+				 */
+				PropertyConnection connect(int group, const boost::function<void()>& func,
+				  boost::signals2::connect_position pos = boost::signals2::at_back) {
+					return insert(func, 1, group, pos);
+				}
+
+				/**
+				 * Disconnects every slot. The slot functions are destroyed after the writer mutex
+				 * is released.
+				 */
+				void disconnectAll() {
+					Retired retired = { NULL, 0 };
+					boost::lock_guard<boost::mutex> lck(writer);
+					SlotArray* cur = current();
+					if(cur) {
+						for(auto it = cur->slots.begin(); it != cur->slots.end(); ++it)
+							(*it)->connected.store(false, std::memory_order_release);
+					}
+					publish(NULL, retired);
+					dead = 0;
+				}
+			private:
+				/**
+				 * \internal
+				 * Counts a disconnected slot and compacts the array if too many of its slots are
+				 * disconnected. If that runs out of memory, the slots are left to the next connect().
+				 */
+				void slotDisconnected(std::vector<boost::shared_ptr<PropertySlot>>& dropped) {
+					Retired retired = { NULL, 0 };
+					boost::lock_guard<boost::mutex> lck(writer);
+					SlotArray* cur = current();
+					if(!cur || ++dead * PruneRatio <= cur->slots.size())
+						return;
+					try {
+						std::unique_ptr<SlotArray> next(new SlotArray());
+						dropped.reserve(dead);
+						next->slots.reserve(cur->slots.size() - std::min(dead, cur->slots.size()));
+						for(auto it = cur->slots.begin(); it != cur->slots.end(); ++it) {
+							if((*it)->connected.load(std::memory_order_relaxed))
+								next->slots.push_back(*it);
+							else
+								dropped.push_back(*it);
+						}
+						publish(next->slots.empty() ? NULL : next.release(), retired);
+						dead = 0;
+					} catch(const std::bad_alloc&) {
+					}
+				}
+
+				/**
+				 * \internal
+				 * Publishes a new array holding the connected slots of the current one and a new slot.
+				 * The disconnected slots left out are destroyed after the writer mutex is released.
+				 */
+				PropertyConnection insert(const boost::function<void()>& func, int region, int group,
+				  boost::signals2::connect_position pos) {
+					boost::shared_ptr<PropertySlot> slot = boost::make_shared<PropertySlot>(func, region, group);
+					std::unique_ptr<SlotArray> next(new SlotArray());
+					Retired retired = { NULL, 0 };
+					boost::lock_guard<boost::mutex> lck(writer);
+					if(!link)
+						link = boost::make_shared<PropertySlotLink>(static_cast<PropertySlotOwner*>(this));
+					slot->link = link;
+					// Only writers replace the array, so it can not be freed while the mutex is held.
+					SlotArray* cur = current();
+					bool placed = false;
+					if(cur) {
+						next->slots.reserve(cur->slots.size() + 1);
+						for(auto it = cur->slots.begin(); it != cur->slots.end(); ++it) {
+							const PropertySlot& s = **it;
+							if(!s.connected.load(std::memory_order_relaxed))
+								continue;
+							bool after = s.region > region || (s.region == region && s.group > group) ||
+							  (pos == boost::signals2::at_front && s.region == region && s.group == group);
+							if(!placed && after) {
+								next->slots.push_back(slot);
+								placed = true;
+							}
+							next->slots.push_back(*it);
+						}
+					}
+					if(!placed)
+						next->slots.push_back(slot);
+					publish(next.release(), retired);
+					dead = 0;
+					return PropertyConnection(slot);
+				}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyTransaction.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyTransaction class.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYTRANSACTION_H
+#define DPTCPP_CONFIG_PROPERTYTRANSACTION_H
+
+#include <boost/function.hpp>
+#include <map>
+#include <vector>
+
+#include "Property.h"
+#include "PropertyCoreBase.h"
+#include "ChangeToken.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief Changes several properties at once, notifying their subscribers only after all the changes.
+		 *
+		 * Writes are staged with set() and applied by commit(). Every changed property emits its
+		 * changed signal once, after all the values have been written, so subscribers never
+		 * observe a half applied set of changes. Asynchronous notifications are collected in a
+		 * NotificationBatch: a subscriber connected with the same SubscriberId to several of the
+		 * changed properties is notified only once.
+		 *
+		 * Writes not committed when the transaction is destroyed are dropped.
+		 */
+		class PropertyTransaction {
+			private:
+				/**
+				 * \internal
+				 * A staged write.
+				 */
+				struct Write {
+					/**
+					 * The core written, identifying the property.
+					 */
+					PropertyCoreBase* core;
+
+					/**
+					 * Writes the value without notifying subscribers. Returns false if the
+					 * value was equal to the current one.
+					 */
+					boost::function<bool()> apply;
+
+					/**
+					 * Notifies the subscribers of the property.
+					 */
+					boost::function<void()> notify;
+				};
+
+				/**
+				 * \internal
+				 * The staged writes, one per property, in the order the properties were first set.
+				 */
+				std::vector<Write> writes;
+
+				/**
+				 * \internal
+				 * The position of the staged write of each property in writes.
+				 */
+				std::map<PropertyCoreBase*, std::size_t> staged;
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyTransaction(const PropertyTransaction& other) = delete;
+
+				/**
+				 * Constructs an empty transaction.
+				 */
+				PropertyTransaction();
+
+				/**
+				 * Drops the writes not committed.
+				 */
+				~PropertyTransaction();
+
+				/**
+				 * Stages a new value for a property. If a property is set several times,
+				 * only the last value is kept and it is written once, in the place of the
+				 * first set() of the property.
+				 * \param [in] p The property to change.
+				 * \param [in] value The new value of the property. Its type is not deduced, so it may
+				 * be anything convertible to the type of the property.
+				 */
+				template<class T>
+				void set(const Property<T>& p, const typename Property<T>::ValueType& value) {
+					auto it = staged.insert(std::make_pair(p.prop.get(), writes.size())).first;
+					if(it->second == writes.size()) {
+						writes.push_back(Write());
+						writes.back().core = p.prop.get();
+						writes.back().notify = [p]() { p.prop->notifyChanged(); };
+					}
+					writes[it->second].apply = [p, value]() { return p.prop->setValueSilently(value); };
+				}
+
+				/**
+				 * Applies the staged writes and notifies the subscribers of the changed properties.
+				 * Properties whose writes all carried their current value are not notified.
+				 * If a write throws, the writes after it are dropped, the properties already
+				 * changed are notified and the exception is rethrown.
+				 * The transaction is empty afterwards and may be reused.
+				 */
+				void commit();
+
+				/**
+				 * Commits the transaction, tracking the notifications of the changes. (See commit)
+				 * \return The token of the asynchronous notifications raised by the changes.
+				 */
+				ChangeToken commitTracked();
+
+				/**
+				 * Drops the staged writes.
+				 */
+				void rollback();
+
+				/**
+				 * Getter for the number of staged writes.
+				 * \return The number of properties set since the last commit or rollback.
+				 */
+				unsigned size() const;
+		};
+	}
+}
+
+#endif
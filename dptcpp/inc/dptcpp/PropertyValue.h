@@ -0,0 +1,483 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyValue.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyValue storage templates used by PropertyCore.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYVALUE_H
+#define DPTCPP_CONFIG_PROPERTYVALUE_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <type_traits>
+#include <utility>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+
+#include "PropertyCompare.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief Thread-safe storage of the value of a PropertyCore.
+		 *
+		 * The general version keeps the value in an immutable snapshot which is
+		 * replaced as a whole by writers, so readers never see a half written value
+		 * and never wait for a writer (RCU style). A snapshot stays valid for as long
+		 * as somebody holds it, regardless of later writes.
+		 * Trivially copyable types are stored in a sequence lock instead (see the
+		 * specialization below), so the storage chosen for a given T is transparent
+		 * to PropertyCore.
+		 */
+		template<typename T, bool Trivial = std::is_trivially_copyable<T>::value>
+		class PropertyValue {
+			public:
+				/**
+				 * An immutable version of the value.
+				 */
+				typedef boost::shared_ptr<const T> Snapshot;
+
+				/**
+				 * The type returned when reading the value. It is a copy, since a
+				 * reference into a snapshot could be dropped by a concurrent write.
+				 */
+				typedef T ReadType;
+
+				/**
+				 * What a writer hands to the hook of storeChanged(): the new snapshot.
+				 */
+				typedef Snapshot Stored;
+			private:
+				/**
+				 * \internal
+				 * The current snapshot. It is only accessed through the atomic
+				 * shared pointer operations of boost.
+				 */
+				Snapshot current;
+
+				/**
+				 * \internal
+				 * The mutex serializing writers, so a comparison and the following
+				 * write are atomic. Readers never take it.
+				 */
+				boost::mutex writer;
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyValue(const PropertyValue& other) = delete;
+
+				/**
+				 * Constructs the storage with a default constructed value.
+				 */
+				PropertyValue() : current(boost::make_shared<const T>()) {
+				}
+
+				/**
+				 * Constructs the storage with a given value.
+				 * \param [in] value The initial value.
+				 */
+				explicit PropertyValue(const T& value) : current(boost::make_shared<const T>(value)) {
+				}
+
+				/**
+				 * Constructs the storage taking over a given value.
+				 * \param [in] value The initial value.
+				 */
+				explicit PropertyValue(T&& value) : current(boost::make_shared<const T>(std::move(value))) {
+				}
+
+				/**
+				 * Reads the stored value.
+				 * \return A copy of the stored value.
+				 */
+				ReadType load() const {
+					return *snapshot();
+				}
+
+				/**
+				 * Takes the current snapshot of the value. This is cheap: no copy
+				 * of the value is made and no lock of the property is taken.
+				 * \return The current snapshot.
+				 */
+				Snapshot snapshot() const {
+					return boost::atomic_load(&current);
+				}
+
+				/**
+				 * Publishes a new snapshot holding a given value.
+				 * \param [in] nValue The new value.
+				 */
+				void store(const T& nValue) {
+					Snapshot next = boost::make_shared<const T>(nValue);
+					boost::lock_guard<boost::mutex> lck(writer);
+					boost::atomic_store(&current, next);
+				}
+
+				/**
+				 * Publishes a new snapshot holding a given value, unless the value
+				 * is equal to the current one. (See PropertyCompare)
+				 * \param [in] nValue The new value.
+				 * \return True if the value was changed.
+				 */
+				bool storeChanged(const T& nValue) {
+					return storeChanged(nValue, [](const Stored&) {});
+				}
+
+				/**
+				 * Publishes a new snapshot holding a given value, unless the value
+				 * is equal to the current one, and calls a hook with the new snapshot
+				 * while still holding the writer mutex, so the calls of the hook are
+				 * ordered like the writes.
+				 * \param [in] nValue The new value.
+				 * \param [in] hook The function to call with the new snapshot.
+				 * \return True if the value was changed.
+				 */
+				template<class Hook>
+				bool storeChanged(const T& nValue, Hook hook) {
+					boost::lock_guard<boost::mutex> lck(writer);
+					// Only writers replace current, so it can be read without atomic_load here.
+					if(propertyEqual(*current, nValue))
+						return false;
+					Snapshot next = boost::make_shared<const T>(nValue);
+					boost::atomic_store(&current, next);
+					hook(next);
+					return true;
+				}
+
+				/**
+				 * Publishes a new snapshot taking over a given value, unless the value
+				 * is equal to the current one. (See storeChanged)
+				 * \param [in] nValue The new value. It is left unspecified if it was moved.
+				 * \param [in] hook The function to call with the new snapshot.
+				 * \return True if the value was changed.
+				 */
+				template<class Hook>
+				bool storeChanged(T&& nValue, Hook hook) {
+					boost::lock_guard<boost::mutex> lck(writer);
+					if(propertyEqual(*current, nValue))
+						return false;
+					Snapshot next = boost::make_shared<const T>(std::move(nValue));
+					boost::atomic_store(&current, next);
+					hook(next);
+					return true;
+				}
+
+				/**
+				 * Publishes a new snapshot holding a value constructed in place, unless the
+				 * value is equal to the current one. The value is constructed before the
+				 * writer mutex is taken, and never copied.
+				 * \param [in] hook The function to call with the new snapshot. (See storeChanged)
+				 * \param [in] args The arguments of the constructor of the value.
+				 * \return True if the value was changed.
+				 */
+				template<class Hook, class... Args>
+				bool storeEmplaced(Hook hook, Args&&... args) {
+					Snapshot next = boost::make_shared<const T>(std::forward<Args>(args)...);
+					boost::lock_guard<boost::mutex> lck(writer);
+					if(propertyEqual(*current, *next))
+						return false;
+					boost::atomic_store(&current, next);
+					hook(next);
+					return true;
+				}
+
+				/**
+				 * Replaces the value by a function of the current one, atomically with
+				 * respect to other writers. Nothing is stored if the function declines
+				 * or the result is equal to the current value.
+				 * \param [in] fn Called as fn(current, next) with next holding a copy of the
+				 * current value. It should modify next and return false to leave the value alone.
+				 * \param [in] hook The function to call with the new snapshot. (See storeChanged)
+				 * \return True if the value was changed.
+				 */
+				template<class Fn, class Hook>
+				bool storeUpdate(Fn fn, Hook hook) {
+					boost::lock_guard<boost::mutex> lck(writer);
+					// The new value is built in its snapshot, so it is copied only once.
+					boost::shared_ptr<T> nValue = boost::make_shared<T>(*current);
+					if(!fn(*current, *nValue) || propertyEqual(*current, *nValue))
+						return false;
+					Snapshot next(nValue);
+					boost::atomic_store(&current, next);
+					hook(next);
+					return true;
+				}
+
+				/**
+				 * Like storeUpdate(), but trusts the function to tell whether it changed the
+				 * value instead of comparing the result to the current value, which would be
+				 * as expensive as the edit for large containers.
+				 * \param [in] fn Called as fn(current, next). It returns true if it changed next.
+				 * \param [in] hook The function to call with the new snapshot. (See storeChanged)
+				 * \return True if the value was changed.
+				 */
+				template<class Fn, class Hook>
+				bool storeEdited(Fn fn, Hook hook) {
+					boost::lock_guard<boost::mutex> lck(writer);
+					boost::shared_ptr<T> nValue = boost::make_shared<T>(*current);
+					if(!fn(*current, *nValue))
+						return false;
+					Snapshot next(nValue);
+					boost::atomic_store(&current, next);
+					hook(next);
+					return true;
+				}
+		};
+
+		/**
+		 * \brief Sequence lock based storage for trivially copyable values.
+		 *
+		 * Readers never write shared memory: they copy the value and retry if a writer
+		 * was active meanwhile, which is detected through an odd or changed sequence number.
+		 * The value is kept in an array of atomic words, so the copy made by a reader
+		 * racing with a writer is well defined, only discarded.
+		 * Writers are serialized by a plain mutex.
+		 */
+		template<typename T>
+		class PropertyValue<T, true> {
+			private:
+				/**
+				 * \internal
+				 * The number of machine words needed to hold a T.
+				 */
+				static const std::size_t Words = (sizeof(T) + sizeof(std::size_t) - 1) / sizeof(std::size_t);
+
+				/**
+				 * \internal
+				 * The sequence number. It is odd while a write is in progress.
+				 */
+				std::atomic<unsigned> seq;
+
+				/**
+				 * \internal
+				 * The bytes of the stored value.
+				 */
+				std::atomic<std::size_t> words[Words];
+
+				/**
+				 * \internal
+				 * The mutex serializing writers.
+				 */
+				boost::mutex writer;
+
+				/**
+				 * \internal
+				 * Copies a value into the word array. The caller must hold the writer mutex
+				 * or be the constructor.
+				 */
+				void put(const T& nValue) {
+					std::size_t buf[Words] = {};
+					std::memcpy(buf, &nValue, sizeof(T));
+					for(std::size_t i = 0; i < Words; ++i)
+						words[i].store(buf[i], std::memory_order_relaxed);
+				}
+
+				/**
+				 * \internal
+				 * Copies a value out of words read from the array. The bytes are copied into raw
+				 * storage, so T needs no default constructor.
+				 */
+				static T assemble(const std::size_t* buf) {
+					typename std::aligned_storage<sizeof(T), alignof(T)>::type rv;
+					std::memcpy(&rv, buf, sizeof(T));
+					return *reinterpret_cast<const T*>(&rv);
+				}
+
+				/**
+				 * \internal
+				 * Reads the value without checking the sequence number. The caller must hold
+				 * the writer mutex.
+				 */
+				T get() const {
+					std::size_t buf[Words];
+					for(std::size_t i = 0; i < Words; ++i)
+						buf[i] = words[i].load(std::memory_order_relaxed);
+					return assemble(buf);
+				}
+
+				/**
+				 * \internal
+				 * Overwrites the value inside a write section of the sequence lock. The caller
+				 * must hold the writer mutex.
+				 */
+				void write(const T& nValue) {
+					unsigned s = seq.load(std::memory_order_relaxed);
+					seq.store(s + 1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_release);
+					put(nValue);
+					seq.store(s + 2, std::memory_order_release);
+				}
+			public:
+				/**
+				 * An immutable copy of the value. (See the general PropertyValue)
+				 */
+				typedef boost::shared_ptr<const T> Snapshot;
+
+				/**
+				 * The type returned when reading the value.
+				 */
+				typedef T ReadType;
+
+				/**
+				 * What a writer hands to the hook of storeChanged(): the new value.
+				 */
+				typedef T Stored;
+
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyValue(const PropertyValue& other) = delete;
+
+				/**
+				 * Constructs the storage with a value initialized T. Only this constructor
+				 * requires T to be default constructible.
+				 */
+				PropertyValue() : seq(0) {
+					put(T());
+				}
+
+				/**
+				 * Constructs the storage with a given value.
+				 * \param [in] value The initial value.
+				 */
+				explicit PropertyValue(const T& value) : seq(0) {
+					put(value);
+				}
+
+				/**
+				 * Reads a consistent copy of the stored value without taking any lock.
+				 * \return A copy of the stored value.
+				 */
+				ReadType load() const {
+					std::size_t buf[Words];
+					unsigned before, after;
+					do {
+						before = seq.load(std::memory_order_acquire);
+						for(std::size_t i = 0; i < Words; ++i)
+							buf[i] = words[i].load(std::memory_order_relaxed);
+						std::atomic_thread_fence(std::memory_order_acquire);
+						after = seq.load(std::memory_order_relaxed);
+					} while((before & 1) || before != after);
+					return assemble(buf);
+				}
+
+				/**
+				 * Takes an immutable copy of the value. Reading the value directly
+				 * with load() is cheaper for trivially copyable types, this is only
+				 * provided to keep the interface uniform.
+				 * \return A snapshot of the value.
+				 */
+				Snapshot snapshot() const {
+					return boost::make_shared<const T>(load());
+				}
+
+				/**
+				 * Overwrites the stored value.
+				 * \param [in] nValue The new value.
+				 */
+				void store(const T& nValue) {
+					boost::lock_guard<boost::mutex> lck(writer);
+					write(nValue);
+				}
+
+				/**
+				 * Overwrites the stored value, unless it is equal to the new one.
+				 * (See PropertyCompare)
+				 * \param [in] nValue The new value.
+				 * \return True if the value was changed.
+				 */
+				bool storeChanged(const T& nValue) {
+					return storeChanged(nValue, [](const Stored&) {});
+				}
+
+				/**
+				 * Overwrites the stored value, unless it is equal to the new one, and calls
+				 * a hook with the new value while still holding the writer mutex.
+				 * \param [in] nValue The new value.
+				 * \param [in] hook The function to call with the new value.
+				 * \return True if the value was changed.
+				 */
+				template<class Hook>
+				bool storeChanged(const T& nValue, Hook hook) {
+					boost::lock_guard<boost::mutex> lck(writer);
+					if(propertyEqual(get(), nValue))
+						return false;
+					write(nValue);
+					hook(nValue);
+					return true;
+				}
+
+				/**
+				 * Overwrites the stored value with a value constructed from given arguments,
+				 * unless it is equal to the current one. (See the general PropertyValue)
+				 * \param [in] hook The function to call with the new value.
+				 * \param [in] args The arguments of the constructor of the value.
+				 * \return True if the value was changed.
+				 */
+				template<class Hook, class... Args>
+				bool storeEmplaced(Hook hook, Args&&... args) {
+					return storeChanged(T(std::forward<Args>(args)...), hook);
+				}
+
+				/**
+				 * Replaces the value by a function of the current one, atomically with
+				 * respect to other writers. (See the general PropertyValue)
+				 * \param [in] fn Called as fn(current, next).
+				 * \param [in] hook The function to call with the new value.
+				 * \return True if the value was changed.
+				 */
+				template<class Fn, class Hook>
+				bool storeUpdate(Fn fn, Hook hook) {
+					boost::lock_guard<boost::mutex> lck(writer);
+					const T old = get();
+					T nValue = old;
+					if(!fn(old, nValue) || propertyEqual(old, nValue))
+						return false;
+					write(nValue);
+					hook(nValue);
+					return true;
+				}
+
+				/**
+				 * Replaces the value by a function of the current one without comparing the
+				 * result to the current value. (See the general PropertyValue)
+				 * \param [in] fn Called as fn(current, next). It returns true if it changed next.
+				 * \param [in] hook The function to call with the new value.
+				 * \return True if the value was changed.
+				 */
+				template<class Fn, class Hook>
+				bool storeEdited(Fn fn, Hook hook) {
+					boost::lock_guard<boost::mutex> lck(writer);
+					const T old = get();
+					T nValue = old;
+					if(!fn(old, nValue))
+						return false;
+					write(nValue);
+					hook(nValue);
+					return true;
+				}
+		};
+	}
+}
+
+#endif
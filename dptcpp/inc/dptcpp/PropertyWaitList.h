@@ -0,0 +1,145 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file PropertyWaitList.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the PropertyWaitList and PropertyWaiter classes.
+ */
+#ifndef DPTCPP_CONFIG_PROPERTYWAITLIST_H
+#define DPTCPP_CONFIG_PROPERTYWAITLIST_H
+
+#include <boost/thread/mutex.hpp>
+
+namespace denprot {
+	namespace config {
+		class PropertyWaitList;
+
+		/**
+		 * \brief An entry of a PropertyWaitList.
+		 *
+		 * The waiter is linked into the list itself, so waiting does not allocate: the waiter
+		 * usually lives in the frame of the waiting coroutine. (See PropertyAwaiter)
+		 */
+		class PropertyWaiter {
+			friend class PropertyWaitList;
+			private:
+				/**
+				 * \internal
+				 * The link pointing to this waiter, NULL while it is not in a list.
+				 */
+				PropertyWaiter** link;
+
+				/**
+				 * \internal
+				 * The next waiter of the list.
+				 */
+				PropertyWaiter* next;
+			protected:
+				PropertyWaiter() : link(NULL), next(NULL) {
+				}
+
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyWaiter(const PropertyWaiter& other) = delete;
+				PropertyWaiter& operator=(const PropertyWaiter& other) = delete;
+
+				virtual ~PropertyWaiter() {
+				}
+
+				/**
+				 * Called with the list locked when the property is notified, on the notifying thread.
+				 * Must not throw and must not use the list.
+				 * \return True if the waiter has to be removed from the list and woken.
+				 */
+				virtual bool ready() = 0;
+
+				/**
+				 * Called once the waiter was removed from the list by a notification, after the
+				 * list is unlocked. The waiter may be destroyed by the call.
+				 */
+				virtual void wake() = 0;
+		};
+
+		/**
+		 * \brief The waiters of a property.
+		 *
+		 * A PropertyCore creates its list when the first waiter arrives and connects notify() to
+		 * its changed signal, so the list is only a single subscriber of the property however
+		 * many waiters it has.
+		 */
+		class PropertyWaitList {
+			private:
+				/**
+				 * \internal
+				 * The mutex guarding the links of the waiters.
+				 */
+				boost::mutex lock;
+
+				/**
+				 * \internal
+				 * The first waiter, in the order they were added.
+				 */
+				PropertyWaiter* head;
+
+				/**
+				 * \internal
+				 * The link of the last waiter, where the next one is added.
+				 */
+				PropertyWaiter** tail;
+
+				/**
+				 * \internal
+				 * Removes a waiter from the list. The list must be locked.
+				 */
+				void unlink(PropertyWaiter& waiter);
+			public:
+				PropertyWaitList();
+
+				/**
+				 * Copying is prohibited.
+				 */
+				PropertyWaitList(const PropertyWaitList& other) = delete;
+
+				/**
+				 * Adds a waiter to the end of the list.
+				 * \param [in] waiter The waiter. Must not be in a list.
+				 * \param [in] check If true, the waiter is only added if its ready() returns false. It is
+				 * called with the list locked, so no notification can get between the check and the add.
+				 * \return True if the waiter was added.
+				 */
+				bool add(PropertyWaiter& waiter, bool check = false);
+
+				/**
+				 * Removes a waiter from the list, unless a notification already did.
+				 * \param [in] waiter The waiter.
+				 * \return True if the waiter was removed, false if it was not in the list.
+				 */
+				bool remove(PropertyWaiter& waiter);
+
+				/**
+				 * Removes and wakes the waiters which are ready, in the order they were added.
+				 * If waking a waiter throws, the others are still woken, and the first exception
+				 * is rethrown afterwards.
+				 */
+				void notify();
+		};
+	}
+}
+
+#endif
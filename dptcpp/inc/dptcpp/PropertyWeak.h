@@ -18,55 +18,63 @@
 #ifndef DPTCPP_CONFIG_PROPERTYWEAK_H
 #define DPTCPP_CONFIG_PROPERTYWEAK_H
 
+#include <boost/intrusive_ptr.hpp>
+#include <boost/optional.hpp>
+
 #include "PropertyCore-fwd.h"
 #include "Property.h"
-#include <boost/weak_ptr.hpp>
 
 namespace denprot {
 	namespace config {
+		/**
+		 * \brief A weak reference to a property.
+		 *
+		 * A PropertyWeak does not keep the property alive, but it can be raised to a
+		 * Property as long as any Property or PropertyReadOnly refers to the same core.
+		 */
 		template <class T>
 		class PropertyWeak {
 			private:
-				boost::weak_ptr<PropertyCore<T>> weak;
-				unsigned* refCnt;
-				boost::mutex* mut;
+				/**
+				 * \internal
+				 * The core referred to. A weak reference of it is held.
+				 */
+				PropertyCore<T>* core;
 			public:
 				friend class Property<T>;
-				PropertyWeak(Property<T> p) {
-					p.mut->lock();
-					weak = p.prop;
-					refCnt = p.refCnt;
-					++(*refCnt);
-					mut = p.mut;
-					p.mut->unlock();
+				PropertyWeak(const Property<T>& p) : core(p.prop.get()) {
+					core->weakAddRef();
+				}
+
+				/**
+				 * \internal
+				 * Constructs a weak reference of a core.
+				 */
+				explicit PropertyWeak(PropertyCore<T>* core) : core(core) {
+					core->weakAddRef();
 				}
 		
-				PropertyWeak(const PropertyWeak& other) {
-					other.mut->lock();
-					weak = other.weak;
-					refCnt = other.refCnt;
-					++(*refCnt);
-					mut = other.mut;
-					other.mut->unlock();
+				PropertyWeak(const PropertyWeak& other) : core(other.core) {
+					core->weakAddRef();
 				}
 		
 				~PropertyWeak() {
-					mut->lock();
-					--(*refCnt);
-					if(*refCnt == 0) {
-						delete refCnt;
-						mut->unlock();
-						delete mut;
-					} else
-						mut->unlock();
+					core->weakRelease();
 				}
+
+				/**
+				 * Copying by assignment is prohibited.
+				 */
+				PropertyWeak& operator=(const PropertyWeak& other) = delete;
 		
+				/**
+				 * Tries to get a strong reference of the property.
+				 * \param [out] p Set to a newly allocated Property on success, NULL otherwise.
+				 * \return True if the property still exists.
+				 */
 				bool raise(Property<T>** p) {
-					mut->lock();
-					boost::shared_ptr<PropertyCore<T>> strong = weak.lock();
-					mut->unlock();
-					if(strong) {
-						*p = new Property<T>(strong, refCnt, mut);
+					if(core->tryAddRef()) {
+						*p = new Property<T>(typename Property<T>::PropertyCoreDyn(core, false));
 						return true;
 					} else {
 						*p = NULL;
@@ -74,6 +82,27 @@ namespace denprot {
 				
 					}
 				}
+
+				/**
+				 * Tries to get a strong reference of the property without allocating: the
+				 * handle is returned by value and costs a single atomic upgrade of the reference.
+				 * \return The property, or nothing if it does not exist anymore.
+				 */
+				boost::optional<Property<T>> raise() const {
+					if(core->tryAddRef())
+						return boost::optional<Property<T>>(Property<T>(typename Property<T>::PropertyCoreDyn(core, false)));
+					return boost::optional<Property<T>>();
+				}
+
+				/**
+				 * Tries to get a strong reference of the core.
+				 * \return The core, or an empty pointer if the property does not exist anymore.
+				 */
+				boost::intrusive_ptr<PropertyCore<T>> lock() const {
+					if(core->tryAddRef())
+						return boost::intrusive_ptr<PropertyCore<T>>(core, false);
+					return boost::intrusive_ptr<PropertyCore<T>>();
+				}
 		};
 	}
 }
@@ -0,0 +1,254 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file Reactor.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the Reactor class.
+ */
+#ifndef DPTCPP_CONFIG_REACTOR_H
+#define DPTCPP_CONFIG_REACTOR_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <atomic>
+
+#include "ReactorBackend.h"
+#include "ReactorMetrics.h"
+
+namespace denprot {
+	namespace config {
+		class PropertyReactor;
+
+		/**
+		 * \brief A pool of threads running the asynchronous subscribers of properties.
+		 *
+		 * Every reactor has its own queues and threads, so subsystems may be isolated from
+		 * each other: a property bound to a reactor (see Property::setReactor) notifies its
+		 * asynchronous subscribers there. Properties not bound to any reactor use the global
+		 * one, controlled by the static methods of PropertyReactor.
+		 *
+		 * A reactor may be started again after it was stopped. The ordering guarantees are
+		 * the ones of PropertyReactor.
+		 *
+		 * The last reference of a reactor may be dropped by one of its own threads, e.g. by
+		 * a function posted to it. The threads can not join themselves, so stopping is then
+		 * left to a detached thread, which keeps the backend and the metrics until it is done.
+		 */
+		class Reactor : public boost::enable_shared_from_this<Reactor> {
+			public:
+				friend class PropertyReactor;
+
+				typedef boost::shared_ptr<Reactor> Dyn;
+
+				/**
+				 * The executors a reactor can run on.
+				 */
+				enum Backend {
+					/**
+					 * A boost::asio::io_service shared by the threads. (See AsioReactorBackend)
+					 */
+					Asio,
+
+					/**
+					 * A deque per thread with work stealing. (See StealingReactorBackend)
+					 */
+					WorkStealing
+				};
+			private:
+				/**
+				 * \internal
+				 * \brief The executor running the functions posted, or NULL while stopped.
+				 */
+				std::atomic<ReactorBackend*> backend;
+
+				/**
+				 * \internal
+				 * \brief The number of posts in progress. The backend is only deleted once it is zero.
+				 */
+				std::atomic<unsigned> posting;
+
+				/**
+				 * \internal
+				 * \brief The number of sync() and flush() calls in progress. The backend is only shut down
+				 * once it is zero. Shared with the thread stopping the reactor from one of its own threads,
+				 * which may outlive the reactor.
+				 */
+				boost::shared_ptr<std::atomic<unsigned>> waiting;
+
+				/**
+				 * \internal
+				 * \brief True while the reactor is being stopped: sync() and flush() are refused.
+				 */
+				std::atomic<bool> closing;
+
+				/**
+				 * \internal
+				 * \brief The threads running the reactor, unless started by PropertyReactor::starter.
+				 */
+				boost::shared_ptr<boost::thread_group> threads;
+
+				/**
+				 * \internal
+				 * \brief The number of threads running the reactor.
+				 */
+				unsigned threadCount;
+
+				/**
+				 * \internal
+				 * \brief The metrics of the functions run, kept across restarts.
+				 */
+				boost::shared_ptr<ReactorMetrics> metrics;
+
+				Reactor();
+
+				/**
+				 * \internal
+				 * Runs a backend on the calling thread, marking the thread as one of the backend.
+				 */
+				static void serve(ReactorBackend* backend);
+
+				/**
+				 * \internal
+				 * True if the calling thread runs the backend of this reactor.
+				 */
+				bool isOwnThread() const;
+
+				/**
+				 * \internal
+				 * Creates the backend, without starting any thread.
+				 */
+				void open(unsigned count, Backend kind);
+
+				/**
+				 * \internal
+				 * Takes the backend out of the reactor, waiting for the posts still using it.
+				 * \return The backend, NULL if the reactor was not started.
+				 */
+				ReactorBackend* detach();
+
+				/**
+				 * \internal
+				 * Refuses new sync() and flush() calls and waits for the ones in progress, while the
+				 * threads still run. Called before the backend is shut down.
+				 */
+				void drainWaits();
+
+				/**
+				 * \internal
+				 * Drops the backend once its threads are joined.
+				 */
+				void close();
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				Reactor(const Reactor& other) = delete;
+
+				/**
+				 * Creates a reactor. It has to be started before anything is posted to it.
+				 * \return The new reactor.
+				 */
+				static Dyn create();
+
+				/**
+				 * Stops the reactor if it is running. (See stop)
+				 */
+				~Reactor();
+
+				/**
+				 * Starts the reactor.
+				 * \param [in] count The number of threads. Must be positive.
+				 * \param [in] kind The executor to run the functions on.
+				 * \throw Exception If count is 0 or the reactor is already started.
+				 */
+				void start(unsigned count = 1, Backend kind = Asio);
+
+				/**
+				 * Waits until the reactor ran every function posted, then joins its threads.
+				 * Does nothing if the reactor is not started. Called from a thread of the reactor,
+				 * it returns at once: functions posted afterwards are refused, and the threads run
+				 * the ones queued and are joined by a detached thread.
+				 */
+				void stop();
+
+				/**
+				 * Waits until the reactor ran every function posted so far, and every function
+				 * posted by them. The threads keep running, but the call only returns once no
+				 * function is queued, so it may wait long while other threads keep posting.
+				 * \throw Exception If the reactor is not started or is being stopped, or if
+				 * called from a thread of the reactor, where the wait could never end.
+				 */
+				void sync();
+
+				/**
+				 * Waits until the reactor ran every function posted before the call. Unlike sync(),
+				 * functions posted later are not waited for. To wait for the notifications of a single
+				 * change, see ChangeToken.
+				 * \throw Exception If the reactor is not started or is being stopped, or if
+				 * called from a thread of the reactor, where the wait could never end.
+				 */
+				void flush();
+
+				/**
+				 * Dispatches a function to the reactor, after the functions posted earlier with the same key.
+				 * \param [in] func The function to run in the reactor.
+				 * \param [in] key The ordering key, NULL for the order of the functions posted without a key.
+				 * \param [in] priority The priority class of the function.
+				 * \throw Exception If the reactor is not started.
+				 */
+				void post(const boost::function<void()>& func, const void* key = NULL,
+				          Priority::Class priority = Priority::Normal);
+
+				/**
+				 * Dispatches a function to the reactor like post(), unless the reactor is not started.
+				 * Used to deliver notifications, which must not throw out of the changed signal.
+				 * \param [in] func The function to run in the reactor.
+				 * \param [in] key The ordering key.
+				 * \param [in] priority The priority class of the function.
+				 * \param [in] source The identity of the function in the slow callback reports, NULL for
+				 * the ordering key. (See SlowCallback::source)
+				 * \return False if the reactor is not started and the function was not posted.
+				 */
+				bool tryPost(const boost::function<void()>& func, const void* key = NULL,
+				             Priority::Class priority = Priority::Normal, const void* source = NULL);
+
+				/**
+				 * Getter for the state of the reactor.
+				 * \return True between start() and stop().
+				 */
+				bool isStarted() const;
+
+				/**
+				 * Getter for the number of threads of the reactor.
+				 * \return The number of threads the reactor was started with.
+				 */
+				unsigned getThreadCount() const;
+
+				/**
+				 * Getter for the metrics of the reactor: the depth of its queues and, once timing is
+				 * turned on, the dispatch latency and execution time of the functions run.
+				 * \return The metrics, kept while the reactor is stopped and started again.
+				 */
+				ReactorMetrics& getMetrics();
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file ReactorBackend.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the ReactorBackend interface.
+ */
+#ifndef DPTCPP_CONFIG_REACTORBACKEND_H
+#define DPTCPP_CONFIG_REACTORBACKEND_H
+
+#include <boost/function.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+#include "ReactorQueue.h"
+
+namespace denprot {
+	namespace config {
+		class ReactorMetrics;
+
+		/**
+		 * \brief The priority classes of asynchronous notifications.
+		 *
+		 * A reactor runs the queued notifications of a higher class before any of a lower class.
+		 */
+		struct Priority {
+			enum Class {
+				/**
+				 * Notifications which must be applied with a bounded latency, like health checks.
+				 */
+				Critical,
+
+				/**
+				 * The default class.
+				 */
+				Normal,
+
+				/**
+				 * Notifications which may wait, like statistics.
+				 */
+				Bulk
+			};
+
+			/**
+			 * The number of classes.
+			 */
+			static const unsigned Count = 3;
+		};
+
+		/**
+		 * \brief The executor running the functions posted to a PropertyReactor.
+		 *
+		 * A backend is run by a fixed number of threads, each calling run(). Functions posted
+		 * with the same key and priority run in the order they were posted and never concurrently.
+		 *
+		 * The functions are kept in lanes: the keys of every priority class are mapped to a fixed
+		 * set of lanes by their hash, and every lane keeps its functions in order like a strand.
+		 * Appending to a lane takes no lock: the functions are pushed onto a ReactorQueue, and only
+		 * the poster finding the lane idle schedules it. Scheduling is left to the implementation
+		 * and may lock or allocate, so it is done once per lane going from idle to ready, not once
+		 * per function.
+		 * A lane with queued functions is handed to the threads as a single task by the
+		 * implementation, which should take the tasks of higher classes first. A task runs a
+		 * bounded number of functions of its lane, fewer if a lane of a higher class is waiting.
+		 *
+		 * The backend counts the functions posted and not finished, so sync() waits without
+		 * stopping the threads. Functions posted while a ChangeTracker is open on the posting
+		 * thread hold its token until they ran.
+		 */
+		class ReactorBackend {
+			public:
+				/**
+				 * The number of lanes per thread and priority class of a backend with more than one thread.
+				 */
+				static const unsigned LanesPerThread = 8;
+
+				/**
+				 * The maximum number of functions of a lane run by one task.
+				 */
+				static const unsigned LaneBatch = 16;
+			protected:
+				/**
+				 * \internal
+				 * The functions of the keys mapped to the lane, in order.
+				 */
+				struct Lane {
+					/**
+					 * The functions posted, consumed by the thread running the lane.
+					 */
+					ReactorQueue funcs;
+
+					/**
+					 * True while the lane is queued as a task or being run.
+					 */
+					std::atomic<bool> scheduled;
+
+					/**
+					 * The priority class of the lane.
+					 */
+					Priority::Class priority;
+
+					Lane() : scheduled(false), priority(Priority::Normal) {
+					}
+				};
+
+				/**
+				 * \internal
+				 * Records a function in the metrics, settles its token and counts it as finished,
+				 * even if the function throws.
+				 */
+				struct Finish {
+					ReactorBackend* backend;
+					const ReactorTask* task;
+					Priority::Class priority;
+					std::chrono::steady_clock::time_point startedAt;
+					~Finish();
+				};
+
+				/**
+				 * \internal
+				 * The metrics of the reactor running the backend.
+				 */
+				ReactorMetrics& metrics;
+
+				/**
+				 * \internal
+				 * The number of lanes per class.
+				 */
+				unsigned laneCount;
+
+				/**
+				 * \internal
+				 * The lanes of every class, one class after the other.
+				 */
+				boost::scoped_array<Lane> lanes;
+
+				/**
+				 * \internal
+				 * The number of tasks of every class waiting for a thread. Maintained by the
+				 * implementation with queued() and dequeued().
+				 */
+				std::atomic<unsigned long> waiting[Priority::Count];
+
+				/**
+				 * \internal
+				 * The number of functions posted and not finished.
+				 */
+				std::atomic<unsigned long> outstanding;
+
+				/**
+				 * \internal
+				 * The mutex guarding the wait of sync() on drained.
+				 */
+				boost::mutex drainLock;
+
+				/**
+				 * \internal
+				 * Notified when outstanding drops to zero.
+				 */
+				boost::condition_variable drained;
+
+				/**
+				 * \internal
+				 * Constructs the lanes for a number of threads. One thread gets a single lane per
+				 * class, keeping the order of every function of the class.
+				 * \param [in] threads The number of threads which will call run().
+				 * \param [in] metrics The metrics to record the functions in. Must outlive the backend.
+				 */
+				ReactorBackend(unsigned threads, ReactorMetrics& metrics);
+
+				/**
+				 * \internal
+				 * Maps an ordering key to one of count queues. The NULL key is mapped to the first one.
+				 * \param [in] key The ordering key.
+				 * \param [in] count The number of queues.
+				 * \return The index of the queue of the key.
+				 */
+				static std::size_t indexOf(const void* key, std::size_t count) {
+					std::size_t h = reinterpret_cast<std::size_t>(key);
+					return (h >> 4 ^ h >> 12) % count;
+				}
+
+				/**
+				 * \internal
+				 * Appends a function to a lane, holding the token of the ChangeTracker open on the
+				 * calling thread, if any. If an exception is thrown, nothing is posted or held.
+				 * \return The lane if it has to be scheduled as a task, NULL if it is already scheduled.
+				 */
+				Lane* push(Lane* lane, const boost::function<void()>& func, const void* key, const void* source);
+
+				/**
+				 * \internal
+				 * Runs a batch of the functions of a scheduled lane.
+				 * \return True if the lane still has functions and has to be scheduled again.
+				 */
+				bool runLane(Lane* lane);
+
+				/**
+				 * \internal
+				 * Records a task of a class queued for the threads.
+				 */
+				void queued(Priority::Class priority) {
+					waiting[priority].fetch_add(1);
+				}
+
+				/**
+				 * \internal
+				 * Records a task of a class taken by a thread.
+				 */
+				void dequeued(Priority::Class priority) {
+					waiting[priority].fetch_sub(1);
+				}
+
+				/**
+				 * \internal
+				 * Hands a lane with queued functions to the threads as a task.
+				 */
+				virtual void schedule(Lane* lane) = 0;
+			public:
+				virtual ~ReactorBackend() {
+				}
+
+				/**
+				 * Runs the functions posted. Called by every thread of the reactor; returns
+				 * after shutdown().
+				 */
+				virtual void run() = 0;
+
+				/**
+				 * Queues a function.
+				 * \param [in] func The function to run.
+				 * \param [in] key The ordering key. (See PropertyReactor::post)
+				 * \param [in] priority The priority class of the function.
+				 * \param [in] source The identity of the function in the slow callback reports, NULL for
+				 * the ordering key. (See SlowCallback::source)
+				 */
+				void post(const boost::function<void()>& func, const void* key,
+				          Priority::Class priority = Priority::Normal, const void* source = NULL);
+
+				/**
+				 * Waits until no function posted is left: every function posted so far, and every
+				 * function posted by them, ran. Must not be called by a thread of the reactor.
+				 */
+				void sync();
+
+				/**
+				 * Waits until every function posted before the call ran, appending a marker to
+				 * every lane. Functions posted later, even by those functions, are not waited for.
+				 * The markers are not recorded in the ReactorMetrics.
+				 * Must not be called by a thread of the reactor.
+				 */
+				void flush();
+
+				/**
+				 * Lets the threads return from run() once they ran every function posted.
+				 */
+				virtual void shutdown() = 0;
+		};
+	}
+}
+
+#endif
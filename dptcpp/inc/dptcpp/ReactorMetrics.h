@@ -0,0 +1,389 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file ReactorMetrics.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the ReactorMetrics class.
+ */
+#ifndef DPTCPP_CONFIG_REACTORMETRICS_H
+#define DPTCPP_CONFIG_REACTORMETRICS_H
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+#include "ReactorBackend.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief A callback of a reactor which ran longer than the slow threshold.
+		 * (See ReactorMetrics::setSlowThreshold)
+		 */
+		struct SlowCallback {
+			/**
+			 * The ordering key the callback was posted with. For the notifications of a property
+			 * it is the SubscriberId of the connection, or the address of the core of the property
+			 * if the connection has none, shared by every such connection of the property.
+			 */
+			const void* key;
+
+			/**
+			 * The identity of the callback. For the notifications of a property it identifies the
+			 * connection: it is the same for every notification of the connection and differs
+			 * between connections, even without a SubscriberId. For other callbacks it is the key.
+			 */
+			const void* source;
+
+			/**
+			 * The priority class of the callback.
+			 */
+			Priority::Class priority;
+
+			/**
+			 * The time the callback ran for.
+			 */
+			std::chrono::nanoseconds duration;
+		};
+
+		/**
+		 * \brief Statistics of the callbacks run by a Reactor.
+		 *
+		 * The depth of the queues is always counted, with a relaxed atomic update per callback
+		 * posted and run. Timing is off by default, as it reads the clock three times per
+		 * callback; once turned on with setTimed() or by a slow threshold, the time from posting a callback to starting
+		 * it (dispatch latency) and the time it ran for (execution time) are recorded in
+		 * histograms, and callbacks running longer than the slow threshold are reported.
+		 *
+		 * Every counter is updated without locking, so a snapshot taken while the reactor runs
+		 * may be slightly inconsistent, e.g. a callback may be counted as completed before its
+		 * execution time is recorded.
+		 */
+		class ReactorMetrics {
+			public:
+				/**
+				 * The number of buckets of a histogram. Bucket i counts the durations with i
+				 * significant bits in nanoseconds, below 2^i ns; the last bucket counts every
+				 * longer duration too.
+				 */
+				static const unsigned Buckets = 40;
+
+				/**
+				 * \brief A histogram of durations, copied out of the live counters.
+				 */
+				struct Histogram {
+					/**
+					 * The number of durations recorded per bucket.
+					 */
+					unsigned long counts[Buckets];
+
+					/**
+					 * The number of durations recorded.
+					 */
+					unsigned long count;
+
+					/**
+					 * The sum of the durations recorded.
+					 */
+					std::chrono::nanoseconds total;
+
+					/**
+					 * The longest duration recorded.
+					 */
+					std::chrono::nanoseconds max;
+
+					Histogram();
+
+					/**
+					 * Getter for the bound of a bucket.
+					 * \param [in] bucket The index of the bucket.
+					 * \return The durations counted by the bucket are below this, except for the last one.
+					 */
+					static std::chrono::nanoseconds upperBound(unsigned bucket);
+
+					/**
+					 * Getter for the mean of the durations.
+					 * \return The mean, 0 if nothing was recorded.
+					 */
+					std::chrono::nanoseconds mean() const;
+
+					/**
+					 * Estimates a percentile of the durations.
+					 * \param [in] fraction The fraction of the durations, between 0 and 1.
+					 * \return The upper bound of the bucket holding the percentile, at most the
+					 * longest duration; 0 if nothing was recorded.
+					 */
+					std::chrono::nanoseconds percentile(double fraction) const;
+				};
+
+				/**
+				 * \brief The state of the metrics at a point in time.
+				 */
+				struct Snapshot {
+					/**
+					 * The number of callbacks posted and not started yet.
+					 */
+					long queued;
+
+					/**
+					 * The highest value of queued since the metrics were reset.
+					 */
+					long peakQueued;
+
+					/**
+					 * The number of callbacks posted.
+					 */
+					unsigned long posted;
+
+					/**
+					 * The number of callbacks which returned or threw.
+					 */
+					unsigned long completed;
+
+					/**
+					 * The number of callbacks which ran longer than the slow threshold.
+					 */
+					unsigned long slow;
+
+					/**
+					 * The time from posting to starting the timed callbacks.
+					 */
+					Histogram dispatch;
+
+					/**
+					 * The time the timed callbacks ran for.
+					 */
+					Histogram execution;
+
+					/**
+					 * Writes the snapshot as text, one value per line, followed by the nonempty
+					 * buckets of the histograms as their upper bound and count. Durations are
+					 * written in nanoseconds.
+					 * \param [in] out The stream to write to.
+					 */
+					void dump(std::ostream& out) const;
+				};
+			private:
+				/**
+				 * \internal
+				 * The live counters of a histogram.
+				 */
+				struct Counters {
+					std::atomic<unsigned long> counts[Buckets];
+					std::atomic<unsigned long long> total;
+					std::atomic<unsigned long long> max;
+
+					Counters();
+
+					void record(std::chrono::nanoseconds duration);
+
+					void read(Histogram& histogram) const;
+
+					void reset();
+				};
+
+				/**
+				 * \internal
+				 * The number of callbacks posted, the only counter updated by the posting threads.
+				 */
+				std::atomic<unsigned long> posted;
+
+				/**
+				 * \internal
+				 * Keeps the counters updated by the reactor threads off the cache line of posted.
+				 */
+				char padding[64];
+
+				/**
+				 * \internal
+				 * The number of callbacks started. The current depth is posted - started.
+				 */
+				std::atomic<unsigned long> started;
+
+				/**
+				 * \internal
+				 * The peak depth. The depth only drops when a callback is started, so sampling it
+				 * then and when a snapshot is taken catches every maximum.
+				 */
+				std::atomic<long> peakQueued;
+				std::atomic<unsigned long> completed;
+				std::atomic<unsigned long> slow;
+
+				/**
+				 * \internal
+				 * The value of posted at the last reset.
+				 */
+				std::atomic<unsigned long> postedBase;
+				Counters dispatch;
+				Counters execution;
+
+				/**
+				 * \internal
+				 * True if callbacks are timed.
+				 */
+				std::atomic<bool> timed;
+
+				/**
+				 * \internal
+				 * The slow threshold in nanoseconds, 0 if slow callbacks are not detected.
+				 */
+				std::atomic<long long> slowThreshold;
+
+				/**
+				 * \internal
+				 * The function reporting slow callbacks, guarded by handlerLock.
+				 */
+				boost::function<void(const SlowCallback&)> slowHandler;
+
+				/**
+				 * \internal
+				 * The mutex guarding slowHandler.
+				 */
+				boost::mutex handlerLock;
+
+				/**
+				 * \internal
+				 * Raises the peak depth to depth if it is lower.
+				 */
+				void raisePeak(long depth);
+
+				/**
+				 * \internal
+				 * Records the dispatch latency of a timed callback starting now.
+				 * \return The time of starting.
+				 */
+				std::chrono::steady_clock::time_point timeDispatch(std::chrono::steady_clock::time_point postedAt);
+
+				/**
+				 * \internal
+				 * Records the execution time of a timed callback finishing now and reports it if it is slow.
+				 */
+				void timeExecution(std::chrono::steady_clock::time_point startedAt, const void* key,
+				                   const void* source, Priority::Class priority);
+			public:
+				/**
+				 * Constructs metrics with every counter at zero and timing off.
+				 */
+				ReactorMetrics();
+
+				/**
+				 * Copying is prohibited.
+				 */
+				ReactorMetrics(const ReactorMetrics& other) = delete;
+
+				/**
+				 * Reads the metrics.
+				 * \return The current values.
+				 */
+				Snapshot snapshot() const;
+
+				/**
+				 * Clears the counters, the histograms and the peak depth, which restarts from the
+				 * current depth. The current depth is kept.
+				 */
+				void reset();
+
+				/**
+				 * Turns timing on or off. Callbacks posted while timing is off are not timed.
+				 * \param [in] on True to record the histograms and detect slow callbacks.
+				 */
+				void setTimed(bool on);
+
+				/**
+				 * Getter for the state of timing.
+				 * \return True if callbacks are timed.
+				 */
+				bool isTimed() const {
+					return timed.load(std::memory_order_relaxed);
+				}
+
+				/**
+				 * Sets the slow threshold. Timed callbacks running longer are counted and passed
+				 * to the handler, on the reactor thread which ran them. A non-zero threshold turns
+				 * timing on (see setTimed), turning detection off leaves timing as it is.
+				 * \param [in] threshold The threshold, zero to turn detection off.
+				 * \param [in] handler The function reporting slow callbacks. May be empty. It must
+				 * not throw.
+				 */
+				void setSlowThreshold(std::chrono::nanoseconds threshold,
+				                      const boost::function<void(const SlowCallback&)>& handler);
+
+				/**
+				 * Getter for the slow threshold.
+				 * \return The threshold, zero if detection is off.
+				 */
+				std::chrono::nanoseconds getSlowThreshold() const {
+					return std::chrono::nanoseconds(slowThreshold.load(std::memory_order_relaxed));
+				}
+
+				/**
+				 * \internal
+				 * Records a callback posted.
+				 * \return The time of posting if callbacks are timed, the epoch of the clock otherwise.
+				 */
+				std::chrono::steady_clock::time_point enqueued() {
+					posted.fetch_add(1, std::memory_order_relaxed);
+					if(!timed.load(std::memory_order_relaxed))
+						return std::chrono::steady_clock::time_point();
+					return std::chrono::steady_clock::now();
+				}
+
+				/**
+				 * \internal
+				 * Takes back a callback recorded by enqueued() which could not be posted after all.
+				 */
+				void withdrawn() {
+					posted.fetch_sub(1, std::memory_order_relaxed);
+				}
+
+				/**
+				 * \internal
+				 * Records a callback taken to be run.
+				 * \param [in] postedAt The result of enqueued() for the callback.
+				 * \return The time of starting the callback, the epoch of the clock if it is not timed.
+				 */
+				std::chrono::steady_clock::time_point dequeued(std::chrono::steady_clock::time_point postedAt) {
+					unsigned long start = started.fetch_add(1, std::memory_order_relaxed);
+					long depth = static_cast<long>(posted.load(std::memory_order_relaxed) - start);
+					if(depth > peakQueued.load(std::memory_order_relaxed))
+						raisePeak(depth);
+					if(postedAt == std::chrono::steady_clock::time_point())
+						return postedAt;
+					return timeDispatch(postedAt);
+				}
+
+				/**
+				 * \internal
+				 * Records a callback which returned or threw.
+				 * \param [in] startedAt The result of dequeued() for the callback.
+				 * \param [in] key The ordering key of the callback.
+				 * \param [in] priority The priority class of the callback.
+				 */
+				void finished(std::chrono::steady_clock::time_point startedAt, const void* key,
+				              const void* source, Priority::Class priority) {
+					completed.fetch_add(1, std::memory_order_relaxed);
+					if(startedAt != std::chrono::steady_clock::time_point())
+						timeExecution(startedAt, key, source, priority);
+				}
+		};
+	}
+}
+
+#endif
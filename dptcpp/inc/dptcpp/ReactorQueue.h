@@ -0,0 +1,186 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file ReactorQueue.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the ReactorQueue class.
+ */
+#ifndef DPTCPP_CONFIG_REACTORQUEUE_H
+#define DPTCPP_CONFIG_REACTORQUEUE_H
+
+#include <boost/function.hpp>
+#include <atomic>
+#include <chrono>
+
+#include "ChangeToken.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief A function queued in a ReactorQueue, with the data its reactor measures it by.
+		 */
+		struct ReactorTask {
+			boost::function<void()> func;
+
+			/**
+			 * The ordering key the function was posted with.
+			 */
+			const void* key;
+
+			/**
+			 * The identity of the function reported if it is slow. (See SlowCallback::source)
+			 */
+			const void* source;
+
+			/**
+			 * The time of posting, or the epoch of the clock if the function is not timed.
+			 * (See ReactorMetrics)
+			 */
+			std::chrono::steady_clock::time_point posted;
+
+			/**
+			 * The token the function holds a hold on until it ran, or NULL. (See ChangeTracker)
+			 */
+			ChangeTokenState* completion;
+
+			ReactorTask() : key(NULL), source(NULL), completion(NULL) {
+			}
+		};
+
+		/**
+		 * \brief A lock-free queue of functions with many producers and a single consumer.
+		 *
+		 * The functions are stored in intrusively linked nodes. A producer links its node with
+		 * a single atomic exchange, so producers never wait for each other or for the consumer;
+		 * the consumer unlinks nodes without any atomic read-modify-write. The queue always
+		 * holds one node already consumed, which is released when the next one is popped.
+		 *
+		 * Nodes are pooled: every thread keeps a cache of free nodes, exchanging batches of
+		 * them with a process wide list when the cache runs empty or grows too large, so
+		 * neither push() nor pop() allocates in the steady state. Nodes are allocated in
+		 * blocks and kept by the pool for the lifetime of the process.
+		 *
+		 * pop() must not be called by two threads at the same time; the owner of the queue has
+		 * to hand the consumer role over with a synchronizing operation.
+		 */
+		class ReactorQueue {
+			public:
+				/**
+				 * \internal
+				 * A queued function, linking to the node queued after it.
+				 */
+				struct Node {
+					std::atomic<Node*> next;
+					ReactorTask task;
+				};
+			private:
+				/**
+				 * \internal
+				 * The node pushed last.
+				 */
+				std::atomic<Node*> head;
+
+				/**
+				 * \internal
+				 * The node consumed last. Only touched by the consumer.
+				 */
+				Node* tail;
+
+				/**
+				 * \internal
+				 * Takes a node from the pool of the current thread.
+				 */
+				static Node* allocate();
+
+				/**
+				 * \internal
+				 * Returns a node to the pool of the current thread.
+				 */
+				static void release(Node* node);
+			public:
+				/**
+				 * The number of free nodes a thread keeps before returning them to the shared list.
+				 */
+				static const unsigned CacheSize = 256;
+
+				ReactorQueue();
+
+				/**
+				 * Copying is prohibited.
+				 */
+				ReactorQueue(const ReactorQueue& other) = delete;
+
+				/**
+				 * Releases the functions still queued without running them, settling their tokens.
+				 */
+				~ReactorQueue();
+
+				/**
+				 * Appends a function. May be called by any thread. If copying the function
+				 * throws, the queue is left unchanged and the hold stays with the caller.
+				 * \param [in] func The function to append.
+				 * \param [in] key The ordering key of the function.
+				 * \param [in] posted The time of posting. (See ReactorTask::posted)
+				 * \param [in] completion The token held by the function, passing the hold to the queue.
+				 * \param [in] source The identity of the function. (See ReactorTask::source)
+				 */
+				void push(const boost::function<void()>& func, const void* key = NULL,
+				          std::chrono::steady_clock::time_point posted = std::chrono::steady_clock::time_point(),
+				          ChangeTokenState* completion = NULL, const void* source = NULL);
+
+				/**
+				 * Removes the first function. Only called by the consumer.
+				 * \param [out] task Receives the function removed.
+				 * \return False if the queue is empty, or the function pushed next is not linked yet.
+				 */
+				bool pop(ReactorTask& task);
+
+				/**
+				 * Checks whether a function was pushed and not popped yet, including a push still
+				 * being linked. Only called by the consumer.
+				 * \return True if the queue is empty.
+				 */
+				bool empty() const {
+					return head.load() == tail;
+				}
+
+				/**
+				 * Getter for the node consumed last, to be checked with pushedAfter() once the
+				 * consumer role is given up. Only called by the consumer.
+				 * \return The node consumed last.
+				 */
+				const Node* consumed() const {
+					return tail;
+				}
+
+				/**
+				 * Checks whether a function was pushed after a node was consumed. May be called by
+				 * any thread. The node may have been reused for a later push by then; that push is
+				 * reported as missing, which is harmless as long as the caller only needs to see the
+				 * pushes made before the node was consumed by someone else.
+				 * \param [in] node The result of an earlier call to consumed().
+				 * \return True if a function was pushed after node.
+				 */
+				bool pushedAfter(const Node* node) const {
+					return head.load() != node;
+				}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file SchemaParseContext.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the SchemaParseContext template class.
+ */
+#ifndef DPTCPP_CONFIG_SCHEMAPARSECONTEXT_H
+#define DPTCPP_CONFIG_SCHEMAPARSECONTEXT_H
+
+#include <libxml++/libxml++.h>
+#include <boost/shared_ptr.hpp>
+#include <glibmm.h>
+#include <bitset>
+#include <vector>
+#include <sstream>
+
+#include "TerminalContext.h"
+#include "PropertySchema.h"
+#include "Exception.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief Loads the values of a PropertySchema from XML.
+		 *
+		 * Handles tags with a name and a value attribute, like PropertyParser, but instead of
+		 * creating a property per tag it writes the value to the property of the schema with the
+		 * same name, converted to the type declared by the key. Register it in a
+		 * TabledParseContext for the tag name used by the file.
+		 *
+		 * Names unknown to the schema are collected rather than rejected, so a single load
+		 * reports all of them; check() reports them together with the keys missing from the file.
+		 * Giving the same key twice is an error.
+		 */
+		template<class Schema>
+		class SchemaParseContext : public TerminalContext {
+			public:
+				typedef boost::shared_ptr<SchemaParseContext<Schema>> Dyn;
+			private:
+				/**
+				 * \internal
+				 * The schema filled. Shares the properties of the schema given to create().
+				 */
+				Schema schema;
+
+				/**
+				 * \internal
+				 * The keys found so far.
+				 */
+				std::bitset<Schema::Size> found;
+
+				/**
+				 * \internal
+				 * The names found so far which are not part of the schema.
+				 */
+				std::vector<Glib::ustring> unknown;
+
+				SchemaParseContext(const Schema& schema) : schema(schema) {
+				}
+			public:
+				static Dyn create(const Schema& schema) {
+					return Dyn(new SchemaParseContext<Schema>(schema));
+				}
+
+				/**
+				 * Method called when this is the active context and a new tag is encountered.
+				 * \param [in] name The name of the tag that has to be handled by this ParseContext
+				 * \param [in] lst The list of attributes of the tag
+				 * \throw Exception If an attribute is missing, the value can not be converted
+				 * or the key was already given.
+				 */
+				void start(const Glib::ustring& name, const xmlpp::SaxParser::AttributeList& lst) {
+					const Glib::ustring* pName = NULL;
+					const Glib::ustring* pValue = NULL;
+					Glib::ustring nameFold = Glib::ustring("name").casefold();
+					Glib::ustring valFold = Glib::ustring("value").casefold();
+					for(auto it = lst.begin(); it != lst.end(); ++it) {
+						if(it->name.casefold() == nameFold)
+							pName = &(it->value);
+						if(it->name.casefold() == valFold)
+							pValue = &(it->value);
+					}
+					if(!pName || !pValue) {
+						std::stringstream strm;
+						strm << "Invalid " << name << " tag: there must be both a name and a value attribute!";
+						throw Exception(strm.str().c_str(),CodePos);
+					}
+					std::size_t index = Schema::find(*pName);
+					if(index == Schema::Size) {
+						unknown.push_back(*pName);
+						return;
+					}
+					if(found[index]) {
+						std::stringstream strm;
+						strm << "Property " << *pName << " is given more than once!";
+						throw Exception(strm.str().c_str(),CodePos);
+					}
+					schema.parse(index, *pValue);
+					found[index] = true;
+				}
+
+				/**
+				 * Method called when this is the active context and a tag is closed.
+				 * \param [in] name The name of the tag closed
+				 */
+				void end(const Glib::ustring& name) {
+				}
+
+				/**
+				 * Getter for the names not part of the schema.
+				 * \return The unknown names found so far, in the order of the file.
+				 */
+				const std::vector<Glib::ustring>& getUnknown() const {
+					return unknown;
+				}
+
+				/**
+				 * Getter for the keys not given. Their properties keep their default values.
+				 * \return The names of the keys not found so far, in the order of the schema.
+				 */
+				std::vector<Glib::ustring> getMissing() const {
+					std::vector<Glib::ustring> rv;
+					for(std::size_t i = 0; i < Schema::Size; ++i) {
+						if(!found[i])
+							rv.push_back(Schema::getName(i));
+					}
+					return rv;
+				}
+
+				/**
+				 * Checks that every key was given and no unknown name was found.
+				 * \throw Exception Listing the unknown and the missing names, if any.
+				 */
+				void check() const {
+					std::vector<Glib::ustring> missing = getMissing();
+					if(unknown.empty() && missing.empty())
+						return;
+					std::stringstream strm;
+					strm << "Configuration does not match the schema.";
+					if(!unknown.empty()) {
+						strm << " Unknown:";
+						for(auto it = unknown.begin(); it != unknown.end(); ++it)
+							strm << ' ' << *it;
+					}
+					if(!missing.empty()) {
+						strm << " Missing:";
+						for(auto it = missing.begin(); it != missing.end(); ++it)
+							strm << ' ' << *it;
+					}
+					throw Exception(strm.str().c_str(),CodePos);
+				}
+		};
+	}
+}
+
+#endif
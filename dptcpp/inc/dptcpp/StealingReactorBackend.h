@@ -0,0 +1,114 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file StealingReactorBackend.h
+ * \author Denes Almasi <denes.almasi@gmail.com>
+ * Declaration of the StealingReactorBackend class.
+ */
+#ifndef DPTCPP_CONFIG_STEALINGREACTORBACKEND_H
+#define DPTCPP_CONFIG_STEALINGREACTORBACKEND_H
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/function.hpp>
+#include <deque>
+#include <atomic>
+
+#include "ReactorBackend.h"
+
+namespace denprot {
+	namespace config {
+		/**
+		 * \brief A ReactorBackend with task deques per thread and work stealing.
+		 *
+		 * A lane with queued functions is scheduled onto the deque of its class of the posting
+		 * thread if it is a thread of the backend, otherwise onto the deques in turn. A thread
+		 * takes the tasks of the highest class waiting, from its own deque first and then
+		 * stealing from the others, so a thread stuck in a slow subscriber does not hold up
+		 * the lanes queued behind it.
+		 */
+		class StealingReactorBackend : public ReactorBackend {
+			private:
+				/**
+				 * \internal
+				 * The task deques of a thread.
+				 */
+				struct Worker {
+					boost::mutex lock;
+					std::deque<Lane*> tasks[Priority::Count];
+				};
+
+				unsigned workerCount;
+				boost::scoped_array<Worker> workers;
+
+				/**
+				 * \internal
+				 * The number of threads entered run(), and the next deque used by foreign threads.
+				 */
+				std::atomic<unsigned> registered, nextWorker;
+
+				/**
+				 * \internal
+				 * The number of tasks in the deques.
+				 */
+				std::atomic<unsigned long> tasks;
+
+				/**
+				 * \internal
+				 * The number of threads waiting for tasks.
+				 */
+				std::atomic<unsigned> sleeping;
+
+				std::atomic<bool> quit;
+				boost::mutex idleLock;
+				boost::condition_variable idle;
+
+				/**
+				 * \internal
+				 * Queues a lane as a task.
+				 */
+				void schedule(Lane* lane);
+
+				/**
+				 * \internal
+				 * Takes a task of the highest class waiting from the deques of a thread,
+				 * or steals one from the others.
+				 */
+				Lane* take(unsigned self);
+			public:
+				/**
+				 * Copying is prohibited.
+				 */
+				StealingReactorBackend(const StealingReactorBackend& other) = delete;
+
+				/**
+				 * Constructs a backend.
+				 * \param [in] threads The number of threads which will call run().
+				 * \param [in] metrics The metrics to record the functions in. Must outlive the backend.
+				 */
+				StealingReactorBackend(unsigned threads, ReactorMetrics& metrics);
+
+				void run();
+
+				void shutdown();
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/bind.hpp>
+
+#include "dptcpp/AsioReactorBackend.h"
+
+namespace denprot {
+namespace config {
+
+AsioReactorBackend::AsioReactorBackend(unsigned threads, ReactorMetrics& metrics) : ReactorBackend(threads, metrics),
+	keeper(new boost::asio::io_service::work(reactor)) {
+}
+
+AsioReactorBackend::~AsioReactorBackend() {
+	delete keeper;
+}
+
+void AsioReactorBackend::run() {
+	reactor.run();
+}
+
+void AsioReactorBackend::schedule(Lane* lane) {
+	{
+		boost::lock_guard<boost::mutex> lck(readyLock);
+		ready[lane->priority].push_back(lane);
+		queued(lane->priority);
+	}
+	reactor.post(boost::bind(&AsioReactorBackend::pump, this));
+}
+
+void AsioReactorBackend::pump() {
+	Lane* lane = NULL;
+	{
+		boost::lock_guard<boost::mutex> lck(readyLock);
+		for(unsigned p = 0; !lane && p < Priority::Count; ++p) {
+			if(!ready[p].empty()) {
+				lane = ready[p].front();
+				ready[p].pop_front();
+				dequeued(lane->priority);
+			}
+		}
+	}
+	if(runLane(lane))
+		schedule(lane);
+}
+
+void AsioReactorBackend::shutdown() {
+	delete keeper;
+	keeper = NULL;
+}
+
+}
+}
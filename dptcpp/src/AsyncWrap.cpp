@@ -16,13 +16,40 @@
  */
  
 #include <boost/function.hpp>
+#include <iostream>
+#include "dptcpp/AsyncWrap.h"
 #include "dptcpp/PropertyReactor.h"
+#include "dptcpp/NotificationBatch.h"
 
 namespace denprot {
 namespace config {
 
 boost::function<void()> asyncWrap(boost::function<void()> func) {
-	return ([func]() { PropertyReactor::post(func); });
+	return asyncWrap(func, NULL);
+}
+
+void asyncPost(const boost::function<void()>& func, SubscriberId subscriber,
+               const boost::function<void()>& dropped, const void* key, Reactor* reactor,
+               Priority::Class priority, const void* source) {
+	const void* order = subscriber ? subscriber : key;
+	NotificationBatch* batch = NotificationBatch::current();
+	if(batch)
+		batch->add(subscriber, func, dropped, order, reactor, priority, source);
+	else
+		asyncDeliver(func, dropped, order, reactor, priority, source);
+}
+
+void asyncDeliver(const boost::function<void()>& func, const boost::function<void()>& dropped,
+                  const void* key, Reactor* reactor, Priority::Class priority, const void* source) {
+	if(reactor ? reactor->tryPost(func, key, priority, source) : PropertyReactor::tryPost(func, key, priority, source))
+		return;
+	std::cerr << "Dropped an asynchronous notification: the reactor is not started!" << std::endl;
+	if(dropped)
+		dropped();
+}
+
+boost::function<void()> asyncWrap(boost::function<void()> func, SubscriberId subscriber) {
+	return ([func, subscriber]() { asyncPost(func, subscriber); });
 }
 
 }
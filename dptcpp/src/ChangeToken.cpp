@@ -0,0 +1,101 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/thread/locks.hpp>
+
+#include "dptcpp/ChangeToken.h"
+
+namespace denprot {
+namespace config {
+
+/**
+ * The state of the innermost tracker open on the current thread.
+ */
+static thread_local ChangeTokenState* openTracker = NULL;
+
+ChangeTokenState::ChangeTokenState() : holds(0), refs(0), resolved(false) {
+}
+
+void ChangeTokenState::settle() {
+	if(holds.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		std::vector<ChangeTokenState*> waiting;
+		{
+			boost::lock_guard<boost::mutex> lck(lock);
+			resolved = true;
+			waiting.swap(dependents);
+			resolvedCond.notify_all();
+		}
+		for(auto it = waiting.begin(); it != waiting.end(); ++it)
+			(*it)->settle();
+	}
+	intrusive_ptr_release(this);
+}
+
+void ChangeTokenState::attach(ChangeTokenState* other) {
+	boost::lock_guard<boost::mutex> lck(lock);
+	if(resolved)
+		return;
+	dependents.push_back(other);
+	other->hold();
+}
+
+bool ChangeTokenState::isResolved() const {
+	boost::lock_guard<boost::mutex> lck(lock);
+	return resolved;
+}
+
+void ChangeTokenState::wait() const {
+	boost::unique_lock<boost::mutex> lck(lock);
+	while(!resolved)
+		resolvedCond.wait(lck);
+}
+
+ChangeTokenState* ChangeTracker::exchange(ChangeTokenState* state) {
+	ChangeTokenState* old = openTracker;
+	openTracker = state;
+	return old;
+}
+
+ChangeTracker::ChangeTracker() : state(new ChangeTokenState()), previous(openTracker) {
+	state->hold();
+	if(previous)
+		state->attach(previous);
+	openTracker = state.get();
+}
+
+ChangeTracker::~ChangeTracker() {
+	if(state)
+		close();
+}
+
+ChangeTokenState* ChangeTracker::current() {
+	return openTracker;
+}
+
+ChangeToken ChangeTracker::close() {
+	if(!state)
+		return ChangeToken();
+	ChangeToken token(state);
+	openTracker = previous;
+	ChangeTokenState* s = state.get();
+	state.reset();
+	s->settle();
+	return token;
+}
+
+}
+}
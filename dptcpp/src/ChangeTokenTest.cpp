@@ -0,0 +1,144 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Regression test of ChangeToken resolution when a NotificationBatch merges notifications
+ * tracked by nested ChangeTrackers.
+ *
+ * The outer tracker waits for the inner one. A batch merging a notification held by the outer
+ * token with a later one held by the inner token used to make the inner token wait for the outer
+ * one as well, so neither ever resolved.
+ *
+ * Built and run by "make check". Exits with a non-zero status on failure.
+ */
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <chrono>
+#include <iostream>
+
+#include "dptcpp/Property.h"
+#include "dptcpp/PropertyReactor.h"
+#include "dptcpp/NotificationBatch.h"
+
+using namespace denprot::config;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+	if(!ok) {
+		std::cout << "FAILED: " << what << std::endl;
+		++failures;
+	}
+}
+
+bool resolves(const ChangeToken& token, std::chrono::milliseconds timeout) {
+	Clock::time_point end = Clock::now() + timeout;
+	while(!token.isDone()) {
+		if(Clock::now() > end)
+			return false;
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	}
+	return true;
+}
+
+int tag;
+
+void noop() {
+}
+
+/*
+ * A notification of the outer tracker merged with a later one of the inner tracker.
+ */
+void mergeNested() {
+	Property<int> p("p", 0);
+	p.connect(boost::function<void()>(&noop), &tag);
+	ChangeToken inner, outer;
+	{
+		ChangeTracker o;
+		{
+			NotificationBatch b;
+			p.setValue(1);
+			inner = p.setValueTracked(2);
+			b.flush();
+		}
+		outer = o.close();
+	}
+	check(resolves(inner, std::chrono::milliseconds(500)), "merged nested: inner token resolves");
+	check(resolves(outer, std::chrono::milliseconds(500)), "merged nested: outer token resolves");
+}
+
+/*
+ * The same merge in the other order: the inner notification first.
+ */
+void mergeNestedReversed() {
+	Property<int> p("p", 0);
+	p.connect(boost::function<void()>(&noop), &tag);
+	ChangeToken inner, outer;
+	{
+		ChangeTracker o;
+		{
+			NotificationBatch b;
+			inner = p.setValueTracked(1);
+			p.setValue(2);
+			b.flush();
+		}
+		outer = o.close();
+	}
+	check(resolves(inner, std::chrono::milliseconds(500)), "merged reversed: inner token resolves");
+	check(resolves(outer, std::chrono::milliseconds(500)), "merged reversed: outer token resolves");
+}
+
+/*
+ * Notifications of unrelated trackers merged in nested batches.
+ */
+void mergeUnrelated() {
+	Property<int> p("p", 0);
+	p.connect(boost::function<void()>(&noop), &tag);
+	ChangeToken first, second, third;
+	{
+		NotificationBatch outerBatch;
+		first = p.setValueTracked(1);
+		{
+			NotificationBatch innerBatch;
+			second = p.setValueTracked(2);
+			third = p.setValueTracked(3);
+			innerBatch.flush();
+		}
+		outerBatch.flush();
+	}
+	check(resolves(first, std::chrono::milliseconds(500)), "merged unrelated: first token resolves");
+	check(resolves(second, std::chrono::milliseconds(500)), "merged unrelated: second token resolves");
+	check(resolves(third, std::chrono::milliseconds(500)), "merged unrelated: third token resolves");
+}
+
+}
+
+int main() {
+	PropertyReactor::start(2);
+	mergeNested();
+	mergeNestedReversed();
+	mergeUnrelated();
+	PropertyReactor::stop();
+	if(failures == 0)
+		std::cout << "ChangeTokenTest: all passed" << std::endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "dptcpp/NotificationBatch.h"
+#include "dptcpp/PropertyReactor.h"
+
+namespace denprot {
+namespace config {
+
+/**
+ * The innermost batch open on the current thread.
+ */
+static thread_local NotificationBatch* openBatch = NULL;
+
+NotificationBatch::NotificationBatch() : previous(openBatch), open(true), handed(0) {
+	openBatch = this;
+}
+
+NotificationBatch::~NotificationBatch() {
+	if(!open)
+		return;
+	try {
+		flush();
+	} catch(...) {
+		std::cerr << "Dropped asynchronous notifications: the batch could not be flushed!" << std::endl;
+	}
+}
+
+NotificationBatch* NotificationBatch::current() {
+	return openBatch;
+}
+
+void NotificationBatch::add(SubscriberId subscriber, const boost::function<void()>& func,
+                            const boost::function<void()>& dropped, const void* key, Reactor* reactor,
+                            Priority::Class priority, const void* source) {
+	Job job;
+	job.subscriber = subscriber;
+	job.func = func;
+	job.dropped = dropped;
+	job.key = key;
+	if(reactor)
+		job.reactor = reactor->shared_from_this();
+	job.priority = priority;
+	job.source = source;
+	job.completion = ChangeTracker::current();
+	job.joint = false;
+	if(job.completion)
+		job.completion->hold();
+	try {
+		add(job);
+	} catch(...) {
+		if(job.completion)
+			job.completion->settle();
+		throw;
+	}
+}
+
+void NotificationBatch::add(const Job& job) {
+	std::pair<SubscriberId, const Reactor*> id(job.subscriber, job.reactor.get());
+	if(job.subscriber) {
+		auto found = seen.find(id);
+		if(found != seen.end()) {
+			// The merged notification runs as early as the most urgent one it replaces.
+			Job& first = jobs[found->second];
+			if(job.priority < first.priority)
+				first.priority = job.priority;
+			// The token of the dropped notification is settled when the first one has run. The
+			// tokens are not attached to each other: one may already wait for the other (nested
+			// trackers), which would make a cycle. A joint token, waiting for nothing, holds both.
+			if(!first.completion)
+				first.completion = job.completion;
+			else if(job.completion && job.completion != first.completion) {
+				if(!first.joint) {
+					ChangeTokenState* joint = new ChangeTokenState();
+					joint->hold();
+					try {
+						joint->attach(first.completion);
+					} catch(...) {
+						joint->settle();
+						throw;
+					}
+					first.completion->settle();
+					first.completion = joint;
+					first.joint = true;
+				}
+				first.completion->attach(job.completion);
+				job.completion->settle();
+			} else if(job.completion)
+				job.completion->settle();
+			if(job.dropped)
+				job.dropped();
+			return;
+		}
+	}
+	jobs.push_back(job);
+	if(job.subscriber) {
+		try {
+			seen.insert(std::make_pair(id, jobs.size() - 1));
+		} catch(...) {
+			jobs.pop_back();
+			throw;
+		}
+	}
+}
+
+void NotificationBatch::discard() noexcept {
+	for(; handed < jobs.size(); ++handed) {
+		Job& job = jobs[handed];
+		if(job.dropped)
+			job.dropped();
+		if(job.completion)
+			job.completion->settle();
+	}
+}
+
+void NotificationBatch::flush() {
+	open = false;
+	openBatch = previous;
+	try {
+		for(; handed < jobs.size(); ++handed) {
+			Job& job = jobs[handed];
+			if(previous) {
+				previous->add(job);
+				continue;
+			}
+			ChangeTokenState* tracked = ChangeTracker::exchange(job.completion);
+			try {
+				asyncDeliver(job.func, job.dropped, job.key, job.reactor.get(), job.priority, job.source);
+			} catch(...) {
+				ChangeTracker::exchange(tracked);
+				throw;
+			}
+			ChangeTracker::exchange(tracked);
+			if(job.completion)
+				job.completion->settle();
+		}
+	} catch(...) {
+		discard();
+		throw;
+	}
+	jobs.clear();
+	seen.clear();
+	handed = 0;
+}
+
+}
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dptcpp/PropertyArena.h"
+#include <boost/thread/locks.hpp>
+
+namespace denprot {
+namespace config {
+
+PropertyArena::PropertyArena() : refs(0), head(NULL), limit(NULL), used(0) {
+	for(std::size_t i = 0; i <= MaxBlock / Grain; ++i)
+		freeLists[i] = NULL;
+}
+
+PropertyArena::~PropertyArena() {
+	for(auto it = chunks.begin(); it != chunks.end(); ++it)
+		delete[] *it;
+}
+
+void* PropertyArena::allocate(std::size_t size) {
+	size = (size + Grain - 1) / Grain * Grain;
+	if(size == 0)
+		size = Grain;
+	if(size > MaxBlock)
+		return ::operator new(size);
+	boost::lock_guard<boost::mutex> lck(lock);
+	used += size;
+	FreeBlock*& list = freeLists[size / Grain];
+	if(list) {
+		FreeBlock* block = list;
+		list = block->next;
+		return block;
+	}
+	if(static_cast<std::size_t>(limit - head) < size) {
+		// The tail of the previous chunk is put on the free lists so it is not lost.
+		while(static_cast<std::size_t>(limit - head) >= Grain) {
+			std::size_t rest = static_cast<std::size_t>(limit - head);
+			std::size_t piece = rest < MaxBlock ? rest / Grain * Grain : MaxBlock;
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(head);
+			block->next = freeLists[piece / Grain];
+			freeLists[piece / Grain] = block;
+			head += piece;
+		}
+		chunks.reserve(chunks.size() + 1);
+		head = new char[ChunkSize];
+		limit = head + ChunkSize;
+		chunks.push_back(head);
+	}
+	void* rv = head;
+	head += size;
+	return rv;
+}
+
+void PropertyArena::deallocate(void* p, std::size_t size) {
+	size = (size + Grain - 1) / Grain * Grain;
+	if(size == 0)
+		size = Grain;
+	if(size > MaxBlock) {
+		::operator delete(p);
+		return;
+	}
+	boost::lock_guard<boost::mutex> lck(lock);
+	used -= size;
+	FreeBlock* block = static_cast<FreeBlock*>(p);
+	block->next = freeLists[size / Grain];
+	freeLists[size / Grain] = block;
+}
+
+std::size_t PropertyArena::getUsed() {
+	boost::lock_guard<boost::mutex> lck(lock);
+	return used;
+}
+
+std::size_t PropertyArena::getReserved() {
+	boost::lock_guard<boost::mutex> lck(lock);
+	return chunks.size() * ChunkSize;
+}
+
+}
+}
@@ -16,6 +16,7 @@
  */
 
 #include "dptcpp/PropertyCollection.h"
+#include <boost/make_shared.hpp>
 #include <sstream>
 
 using std::endl;
@@ -25,7 +26,15 @@ namespace denprot {
 namespace config {
 
 
-	PropertyCollection::PropertyCollection() {}
+	PropertyCollection::PropertyCollection() :
+		arena(new PropertyArena()),
+		propMap(std::less<Glib::ustring>(), PMap::allocator_type(arena)),
+		version(boost::make_shared<std::atomic<unsigned long>>(0)) {}
+
+	PropertyCollection::~PropertyCollection() {
+		for(auto it = propMap.begin(); it != propMap.end(); ++it)
+			it->second->getCoreBase()->leaveCollection();
+	}
 
 	PropertyCollection::Dyn PropertyCollection::create() {
 		return PropertyCollection::Dyn(new PropertyCollection());
@@ -33,14 +42,34 @@ namespace config {
 
 	void PropertyCollection::add(const Glib::ustring& name,
 	                             boost::shared_ptr<PropertyInterface> prop) {
-		auto it = propMap.find(name);
-		if(it != propMap.end()) {
+		auto it = propMap.lower_bound(name);
+		if(it != propMap.end() && !(name < it->first)) {
 			stringstream strm;
 			strm << "Property with name '" << name
 				 << "' already exists in this PropertyCollection" << endl;
 			throw Exception(strm.str().c_str(),CodePos);
 		}
-		propMap[name] = prop;
+		join(prop->getCoreBase(), name);
+		try {
+			propMap.insert(it, PMap::value_type(name, prop));
+		} catch(...) {
+			prop->getCoreBase()->leaveCollection();
+			throw;
+		}
+		added();
+	}
+
+	void PropertyCollection::join(PropertyCoreBase* core, const Glib::ustring& name) {
+		if(!core->joinCollection(version)) {
+			stringstream strm;
+			strm << "Property with name '" << name
+				 << "' is already in a PropertyCollection" << endl;
+			throw Exception(strm.str().c_str(),CodePos);
+		}
+	}
+
+	void PropertyCollection::added() {
+		version->fetch_add(1, std::memory_order_release);
 	}
 	
 	bool PropertyCollection::hasProperty(const Glib::ustring& name) const {
@@ -59,6 +88,35 @@ namespace config {
 		return it->second->getClassId();
 	}
 
+	unsigned long PropertyCollection::getSuppressedCount() const {
+		unsigned long sum = 0;
+		for(auto it = propMap.begin(); it != propMap.end(); ++it)
+			sum += it->second->getSuppressedCount();
+		return sum;
+	}
+
+	unsigned long PropertyCollection::getVersion(const Glib::ustring& name) const {
+		auto it = propMap.find(name);
+		if(it == propMap.end()) {
+			std::stringstream strm;
+			strm << "Could not find property with name: " << name;
+			throw Exception(strm.str().c_str(),CodePos);
+		}
+		return it->second->getVersion();
+	}
+
+	unsigned long PropertyCollection::getVersion() const {
+		return version->load(std::memory_order_acquire);
+	}
+
+	void PropertyCollection::dumpHistories(std::ostream& out) const {
+		for(auto it = propMap.begin(); it != propMap.end(); ++it) {
+			PropertyHistoryBase* h = it->second->getCoreBase()->getHistoryBase();
+			if(h)
+				h->dump(out, it->first);
+		}
+	}
+
 	PropertyCollection::PMap::const_iterator PropertyCollection::begin() const {
 		return propMap.begin();
 	}
@@ -74,15 +132,29 @@ namespace config {
 			strm << "Could not find property with name for removal: " << name;
 			throw Exception(strm.str().c_str(),CodePos);
 		}
+		it->second->getCoreBase()->leaveCollection();
 		propMap.erase(it);
+		version->fetch_add(1, std::memory_order_release);
 	}
 	
+	boost::intrusive_ptr<PropertyArena> PropertyCollection::getArena() const {
+		return arena;
+	}
+
 	PropertyCollection::PMap::const_iterator PropertyCollection::find(const Glib::ustring& name) const {
 		return propMap.find(name);
 	}
 	
 	void PropertyCollection::clear() {
-		propMap.clear();
+		for(auto it = propMap.begin(); it != propMap.end(); ++it)
+			it->second->getCoreBase()->leaveCollection();
+		// Start a new arena: the old one is freed in one go once the properties
+		// still referenced from outside the collection are gone too.
+		boost::intrusive_ptr<PropertyArena> fresh(new PropertyArena());
+		PMap dropped((std::less<Glib::ustring>()), PMap::allocator_type(fresh));
+		propMap.swap(dropped);
+		arena = fresh;
+		version->fetch_add(1, std::memory_order_release);
 	}
 }
 }
@@ -0,0 +1,44 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dptcpp/PropertyCoreBase.h"
+#include "dptcpp/PropertyArena.h"
+#include "dptcpp/PropertyHistory.h"
+
+namespace denprot {
+namespace config {
+
+PropertyCoreBase::~PropertyCoreBase() {
+	delete history.load(std::memory_order_relaxed);
+}
+
+void PropertyCoreBase::destroy() const {
+	PropertyCoreBase* self = const_cast<PropertyCoreBase*>(this);
+	PropertyArena* a = arena;
+	if(!a) {
+		delete self;
+		return;
+	}
+	std::size_t size = footprint();
+	void* block = dynamic_cast<void*>(self);
+	self->~PropertyCoreBase();
+	a->deallocate(block, size);
+	intrusive_ptr_release(a);
+}
+
+}
+}
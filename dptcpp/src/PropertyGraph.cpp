@@ -0,0 +1,263 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <exception>
+#include <sstream>
+#include <boost/make_shared.hpp>
+#include <boost/thread/locks.hpp>
+#include "dptcpp/PropertyGraph.h"
+#include "dptcpp/NotificationBatch.h"
+#include "dptcpp/Exception.h"
+
+namespace denprot {
+namespace config {
+
+namespace {
+	/**
+	 * Marks the graph running on the current thread for the lifetime of a wave. The marks of
+	 * the graphs running on a thread are chained, since a subscriber notified by a wave may
+	 * start a wave of another graph.
+	 */
+	struct Running {
+		const PropertyGraph* graph;
+		Running* previous;
+		Running(const PropertyGraph* graph);
+		~Running();
+	};
+
+	/**
+	 * The innermost wave running on the current thread.
+	 */
+	thread_local Running* openWave = NULL;
+
+	Running::Running(const PropertyGraph* graph) : graph(graph), previous(openWave) {
+		openWave = this;
+	}
+
+	Running::~Running() {
+		openWave = previous;
+	}
+}
+
+PropertyGraph::PropertyGraph() : notifying(NULL), waveNo(0), waves(0), evaluations(0) {
+}
+
+PropertyGraph::~PropertyGraph() {
+	for(auto it = nodes.begin(); it != nodes.end(); ++it)
+		it->second->connection.disconnect();
+}
+
+PropertyGraph::Node* PropertyGraph::node(const PropertyInterface::Dyn& handle, std::vector<Node*>& created) {
+	PropertyCoreBase* core = handle->getCoreBase();
+	auto it = nodes.find(core);
+	if(it != nodes.end())
+		return it->second.get();
+	boost::shared_ptr<Node> n = boost::make_shared<Node>();
+	n->handle = handle;
+	n->rank = 0;
+	n->affectedIn = 0;
+	n->changedIn = 0;
+	Node* raw = n.get();
+	created.reserve(created.size() + 1);
+	n->connection = handle->connectLocal([this, raw]() { changed(raw); });
+	try {
+		nodes[core] = n;
+	} catch(...) {
+		n->connection.disconnect();
+		throw;
+	}
+	created.push_back(raw);
+	return raw;
+}
+
+void PropertyGraph::define(const PropertyInterface::Dyn& target, const boost::function<bool()>& evaluate,
+  const boost::function<void()>& notify, const std::vector<PropertyInterface::Dyn>& inputs) {
+	if(isWaveThread())
+		throw Exception("PropertyGraph: properties can not be defined during propagation", CodePos);
+	boost::unique_lock<boost::mutex> lck(lock);
+	std::vector<Node*> created;
+	Node* t = NULL;
+	std::vector<Node*> in;
+	try {
+		t = node(target, created);
+		if(t->evaluate) {
+			std::stringstream strm;
+			strm << "PropertyGraph: property '" << target->getName() << "' is already defined";
+			throw Exception(strm.str().c_str(), CodePos);
+		}
+		for(auto it = inputs.begin(); it != inputs.end(); ++it)
+			in.push_back(node(*it, created));
+		// Adding the edges makes a cycle iff an input is reachable from the target.
+		std::vector<Node*> stack(1, t);
+		std::vector<Node*> seen;
+		while(!stack.empty()) {
+			Node* n = stack.back();
+			stack.pop_back();
+			if(std::find(seen.begin(), seen.end(), n) != seen.end())
+				continue;
+			seen.push_back(n);
+			if(std::find(in.begin(), in.end(), n) != in.end()) {
+				std::stringstream strm;
+				strm << "PropertyGraph: defining '" << target->getName() << "' would make a cycle";
+				throw Exception(strm.str().c_str(), CodePos);
+			}
+			stack.insert(stack.end(), n->dependents.begin(), n->dependents.end());
+		}
+	} catch(...) {
+		// No edge was added yet, so the nodes created for this definition are unreferenced.
+		for(auto it = created.begin(); it != created.end(); ++it) {
+			(*it)->connection.disconnect();
+			nodes.erase((*it)->handle->getCoreBase());
+		}
+		throw;
+	}
+	t->inputs = in;
+	t->evaluate = evaluate;
+	t->notify = notify;
+	for(auto it = in.begin(); it != in.end(); ++it) {
+		if(std::find((*it)->dependents.begin(), (*it)->dependents.end(), t) == (*it)->dependents.end())
+			(*it)->dependents.push_back(t);
+		t->rank = std::max(t->rank, (*it)->rank + 1);
+	}
+	// Push the ranks of the nodes already depending on the target.
+	std::vector<Node*> stack(1, t);
+	while(!stack.empty()) {
+		Node* n = stack.back();
+		stack.pop_back();
+		for(auto it = n->dependents.begin(); it != n->dependents.end(); ++it) {
+			if((*it)->rank <= n->rank) {
+				(*it)->rank = n->rank + 1;
+				stack.push_back(*it);
+			}
+		}
+	}
+	run(t);
+}
+
+void PropertyGraph::changed(Node* n) {
+	if(isWaveThread()) {
+		if(n != notifying)
+			pending.push_back(n);
+		return;
+	}
+	boost::unique_lock<boost::mutex> lck(lock);
+	pending.push_back(n);
+	run(NULL);
+}
+
+bool PropertyGraph::isWaveThread() const {
+	for(Running* r = openWave; r; r = r->previous) {
+		if(r->graph == this)
+			return true;
+	}
+	return false;
+}
+
+void PropertyGraph::run(Node* force) {
+	Running r(this);
+	std::exception_ptr failure;
+	// The changes made by subscribers of a failed wave are stored already, so they are still
+	// propagated. Every wave consumes the pending changes, so this ends as the subscribers settle.
+	do {
+		try {
+			wave(force);
+		} catch(...) {
+			notifying = NULL;
+			if(!failure)
+				failure = std::current_exception();
+		}
+		force = NULL;
+	} while(!pending.empty());
+	if(failure)
+		std::rethrow_exception(failure);
+}
+
+void PropertyGraph::wave(Node* force) {
+	++waveNo;
+	waves.fetch_add(1, std::memory_order_relaxed);
+	std::vector<Node*> seeds;
+	seeds.swap(pending);
+	std::vector<Node*> order, stack;
+	for(auto it = seeds.begin(); it != seeds.end(); ++it) {
+		(*it)->changedIn = waveNo;
+		stack.push_back(*it);
+	}
+	if(force) {
+		force->affectedIn = waveNo;
+		order.push_back(force);
+		stack.push_back(force);
+	}
+	while(!stack.empty()) {
+		Node* n = stack.back();
+		stack.pop_back();
+		for(auto it = n->dependents.begin(); it != n->dependents.end(); ++it) {
+			if((*it)->affectedIn != waveNo) {
+				(*it)->affectedIn = waveNo;
+				order.push_back(*it);
+				stack.push_back(*it);
+			}
+		}
+	}
+	std::sort(order.begin(), order.end(), [](const Node* a, const Node* b) { return a->rank < b->rank; });
+	std::vector<Node*> changedNodes;
+	changedNodes.reserve(order.size());
+	std::exception_ptr failure;
+	try {
+		for(auto it = order.begin(); it != order.end(); ++it) {
+			Node* n = *it;
+			bool needed = n == force;
+			for(auto in = n->inputs.begin(); !needed && in != n->inputs.end(); ++in)
+				needed = (*in)->changedIn == waveNo;
+			if(!needed || !n->evaluate)
+				continue;
+			evaluations.fetch_add(1, std::memory_order_relaxed);
+			if(n->evaluate()) {
+				n->changedIn = waveNo;
+				changedNodes.push_back(n);
+			}
+		}
+	} catch(...) {
+		// The values stored before the failure are visible, so their subscribers are notified.
+		failure = std::current_exception();
+	}
+	NotificationBatch batch;
+	for(auto it = changedNodes.begin(); it != changedNodes.end(); ++it) {
+		notifying = *it;
+		(*it)->notify();
+	}
+	notifying = NULL;
+	batch.flush();
+	if(failure)
+		std::rethrow_exception(failure);
+}
+
+unsigned PropertyGraph::size() {
+	boost::lock_guard<boost::mutex> lck(lock);
+	return nodes.size();
+}
+
+unsigned long PropertyGraph::getWaves() const {
+	return waves.load(std::memory_order_relaxed);
+}
+
+unsigned long PropertyGraph::getEvaluations() const {
+	return evaluations.load(std::memory_order_relaxed);
+}
+
+}
+}
@@ -0,0 +1,150 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures the cost of copying, moving and destroying Property handles and of reading a value.
+ *
+ * LegacyHandle models the handle Property used to be: a shared core plus a separately allocated reference
+ * count guarded by a separately allocated mutex. It has no move constructor, so moving it copies.
+ *
+ * Build with "make check" and run ./PropertyHandleBench [handles].
+ */
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "dptcpp/Property.h"
+
+using namespace denprot::config;
+
+namespace {
+
+class LegacyHandle {
+	boost::shared_ptr<PropertyCore<int>> prop;
+	unsigned* refCnt;
+	boost::mutex* mut;
+public:
+	LegacyHandle(const Glib::ustring& name, int value) :
+		prop(new PropertyCore<int>(name, value)), refCnt(new unsigned(1)), mut(new boost::mutex()) {
+	}
+
+	LegacyHandle(const LegacyHandle& p) {
+		p.mut->lock();
+		prop = p.prop;
+		mut = p.mut;
+		refCnt = p.refCnt;
+		++(*refCnt);
+		p.mut->unlock();
+	}
+
+	~LegacyHandle() {
+		mut->lock();
+		--(*refCnt);
+		if(*refCnt == 0) {
+			delete refCnt;
+			mut->unlock();
+			delete mut;
+		} else
+			mut->unlock();
+	}
+
+	int getValue() const {
+		return prop->getValue();
+	}
+private:
+	LegacyHandle& operator=(const LegacyHandle&);
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double perOp(Clock::time_point start, unsigned long ops) {
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+}
+
+template<class Handle>
+void measureHandles(const char* name, const Handle& handle, unsigned long n) {
+	std::vector<Handle> copies, moved;
+	copies.reserve(n);
+	moved.reserve(n);
+
+	Clock::time_point start = Clock::now();
+	for(unsigned long i = 0; i < n; ++i)
+		copies.push_back(handle);
+	double copy = perOp(start, n);
+
+	start = Clock::now();
+	for(unsigned long i = 0; i < n; ++i)
+		moved.push_back(std::move(copies[i]));
+	double move = perOp(start, n);
+
+	start = Clock::now();
+	copies.clear();
+	moved.clear();
+	double destroy = perOp(start, n);
+
+	std::cout << name << ": copy " << copy << " ns, move " << move << " ns, destroy " << destroy << " ns" << std::endl;
+}
+
+template<class Handle>
+void measureCreate(const char* name, unsigned long n) {
+	Clock::time_point start = Clock::now();
+	for(unsigned long i = 0; i < n; ++i)
+		Handle h("p", static_cast<int>(i));
+	std::cout << name << ": create+destroy " << perOp(start, n) << " ns" << std::endl;
+}
+
+volatile int sink;
+
+void measureRead(const char* name, Property<int> prop, unsigned long n) {
+	Clock::time_point start = Clock::now();
+	for(unsigned long i = 0; i < n; ++i)
+		sink = prop.getValue();
+	double read = perOp(start, n);
+
+	std::atomic<bool> done(false);
+	boost::thread writer([&]() {
+		for(int i = 0; !done.load(std::memory_order_relaxed); ++i)
+			prop = i;
+	});
+	start = Clock::now();
+	for(unsigned long i = 0; i < n; ++i)
+		sink = prop.getValue();
+	double contended = perOp(start, n);
+	done = true;
+	writer.join();
+
+	std::cout << name << ": getValue " << read << " ns, with a concurrent writer " << contended << " ns" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+	unsigned long n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 2000000;
+
+	measureHandles("legacy handle  ", LegacyHandle("p", 1), n);
+	measureHandles("Property<int>  ", Property<int>("p", 1), n);
+	measureCreate<LegacyHandle>("legacy handle  ", n / 10);
+	measureCreate<Property<int>>("Property<int>  ", n / 10);
+	measureRead("Property<int>  ", Property<int>("p", 1), n);
+	return 0;
+}
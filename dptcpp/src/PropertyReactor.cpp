@@ -15,7 +15,6 @@
  *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <boost/function.hpp>
 
@@ -25,60 +24,78 @@
 namespace denprot {
 namespace config {
 
-boost::asio::io_service 			PropertyReactor::reactor;
-boost::asio::io_service::strand* 	PropertyReactor::strand = NULL;
-boost::thread* 						PropertyReactor::thread = NULL;
-boost::asio::io_service::work* 		PropertyReactor::keeper = NULL;
-boost::barrier* 					PropertyReactor::syncer = NULL;
+Reactor* 							PropertyReactor::reactor = new Reactor();
+boost::thread_group* 				PropertyReactor::threads = NULL;
 PropertyReactor::ThreadStarter 		PropertyReactor::starter = PropertyReactor::defaultStarter;
 PropertyReactor::ThreadKiller		PropertyReactor::killer = PropertyReactor::defaultKiller;
 
-bool PropertyReactor::quit = false;
+const PropertyReactor::Backend PropertyReactor::Asio;
+const PropertyReactor::Backend PropertyReactor::WorkStealing;
 
 void PropertyReactor::handler(void* arg) {
-	while(true) {
-		reactor.run();
-		if(quit)
-			break;
-		reactor.reset();
-		keeper = new boost::asio::io_service::work(reactor);
-		syncer->wait();
-	}
+	Reactor::serve(reactor->backend.load());
 }
 
 void PropertyReactor::start() {
-	keeper = new boost::asio::io_service::work(reactor);
-	syncer = new boost::barrier(2);
-	strand = new boost::asio::io_service::strand(reactor);
-	starter(PropertyReactor::handler);
+	start(1);
+}
+
+void PropertyReactor::start(unsigned count, Backend kind) {
+	reactor->open(count, kind);
+	for(unsigned i = 0; i < count; ++i)
+		starter(PropertyReactor::handler);
+}
+
+unsigned PropertyReactor::getThreadCount() {
+	return reactor->getThreadCount();
+}
+
+ReactorMetrics& PropertyReactor::getMetrics() {
+	return reactor->getMetrics();
 }
 
 void PropertyReactor::stop() {
-	quit = true;
-	delete keeper;
+	if(!reactor->isStarted())
+		return;
+	reactor->drainWaits();
+	reactor->backend.load()->shutdown();
 	killer();
-	delete strand;
-	delete syncer;
+	reactor->close();
 }
 
 void PropertyReactor::post(boost::function<void()> func) {
-	strand->post(func);
+	reactor->post(func);
+}
+
+void PropertyReactor::post(boost::function<void()> func, const void* key, Priority::Class priority) {
+	reactor->post(func, key, priority);
+}
+
+bool PropertyReactor::tryPost(const boost::function<void()>& func, const void* key, Priority::Class priority,
+                              const void* source) {
+	return reactor->tryPost(func, key, priority, source);
 }
 
 void PropertyReactor::sync() {
-	delete keeper;
-	syncer->wait();
+	reactor->sync();
+}
+
+void PropertyReactor::flush() {
+	reactor->flush();
 }
 
 void PropertyReactor::defaultStarter(void(*handler)(void*)) {
 	void* null = NULL;
 	boost::function<void()> func(boost::bind(handler,null));
-	thread = new boost::thread(func);
+	if(!threads)
+		threads = new boost::thread_group();
+	threads->create_thread(func);
 }
 
 void PropertyReactor::defaultKiller() {
-	thread->join();
-	delete thread;
+	threads->join_all();
+	delete threads;
+	threads = NULL;
 }
 
 }
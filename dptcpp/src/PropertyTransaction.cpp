@@ -0,0 +1,76 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include "dptcpp/PropertyTransaction.h"
+#include "dptcpp/NotificationBatch.h"
+
+namespace denprot {
+namespace config {
+
+PropertyTransaction::PropertyTransaction() {
+}
+
+PropertyTransaction::~PropertyTransaction() {
+}
+
+void PropertyTransaction::commit() {
+	std::vector<Write> pending;
+	pending.swap(writes);
+	staged.clear();
+	// Every property has a single write, so the properties changed are the first
+	// written ones.
+	std::vector<Write>::iterator written = pending.begin();
+	std::vector<bool> changed(pending.size());
+	std::exception_ptr failure;
+	try {
+		for(; written != pending.end(); ++written)
+			changed[written - pending.begin()] = written->apply();
+	} catch(...) {
+		failure = std::current_exception();
+	}
+	// The values already written are visible, so their subscribers are notified even if a
+	// later write failed.
+	NotificationBatch batch;
+	for(auto it = pending.begin(); it != written; ++it) {
+		if(changed[it - pending.begin()])
+			it->notify();
+		else if(!failure)
+			it->core->countSuppressed();
+	}
+	batch.flush();
+	if(failure)
+		std::rethrow_exception(failure);
+}
+
+ChangeToken PropertyTransaction::commitTracked() {
+	ChangeTracker tracker;
+	commit();
+	return tracker.close();
+}
+
+void PropertyTransaction::rollback() {
+	writes.clear();
+	staged.clear();
+}
+
+unsigned PropertyTransaction::size() const {
+	return writes.size();
+}
+
+}
+}
@@ -0,0 +1,92 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/thread/locks.hpp>
+#include <exception>
+
+#include "dptcpp/PropertyWaitList.h"
+
+namespace denprot {
+namespace config {
+
+PropertyWaitList::PropertyWaitList() : head(NULL), tail(&head) {
+}
+
+void PropertyWaitList::unlink(PropertyWaiter& waiter) {
+	*waiter.link = waiter.next;
+	if(waiter.next)
+		waiter.next->link = waiter.link;
+	else
+		tail = waiter.link;
+	waiter.link = NULL;
+	waiter.next = NULL;
+}
+
+bool PropertyWaitList::add(PropertyWaiter& waiter, bool check) {
+	boost::lock_guard<boost::mutex> lck(lock);
+	if(check && waiter.ready())
+		return false;
+	waiter.link = tail;
+	*tail = &waiter;
+	tail = &waiter.next;
+	return true;
+}
+
+bool PropertyWaitList::remove(PropertyWaiter& waiter) {
+	boost::lock_guard<boost::mutex> lck(lock);
+	if(!waiter.link)
+		return false;
+	unlink(waiter);
+	return true;
+}
+
+void PropertyWaitList::notify() {
+	PropertyWaiter* woken = NULL;
+	PropertyWaiter** last = &woken;
+	{
+		boost::lock_guard<boost::mutex> lck(lock);
+		PropertyWaiter* waiter = head;
+		while(waiter) {
+			PropertyWaiter* next = waiter->next;
+			if(waiter->ready()) {
+				unlink(*waiter);
+				*last = waiter;
+				last = &waiter->next;
+			}
+			waiter = next;
+		}
+	}
+	// The next pointer is read before waking: a woken waiter may be destroyed. The waiters
+	// are already unlinked, so a failing one must not stop the others from being woken.
+	std::exception_ptr failure;
+	while(woken) {
+		PropertyWaiter* waiter = woken;
+		woken = waiter->next;
+		waiter->next = NULL;
+		try {
+			waiter->wake();
+		} catch(...) {
+			if(!failure)
+				failure = std::current_exception();
+		}
+	}
+	if(failure)
+		std::rethrow_exception(failure);
+}
+
+}
+}
@@ -0,0 +1,210 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "dptcpp/Reactor.h"
+#include "dptcpp/AsioReactorBackend.h"
+#include "dptcpp/StealingReactorBackend.h"
+#include "dptcpp/Exception.h"
+
+namespace denprot {
+namespace config {
+
+/**
+ * The backend run by the current thread, NULL if it runs none.
+ */
+static thread_local ReactorBackend* servedBackend = NULL;
+
+/**
+ * Counts a call in progress, so the backend is not deleted under it. (See Reactor::detach)
+ */
+struct Posting {
+	std::atomic<unsigned>& posting;
+
+	explicit Posting(std::atomic<unsigned>& posting) : posting(posting) {
+		posting.fetch_add(1);
+	}
+
+	~Posting() {
+		posting.fetch_sub(1);
+	}
+};
+
+/**
+ * Waits until the calls counted by a Posting are over.
+ */
+static void drain(const std::atomic<unsigned>& counter) {
+	while(counter.load() != 0)
+		boost::this_thread::yield();
+}
+
+/**
+ * Stops a backend on a thread which is not one of its own. (See Reactor::stop)
+ */
+struct Reaper {
+	ReactorBackend* backend;
+	boost::shared_ptr<boost::thread_group> threads;
+	boost::shared_ptr<ReactorMetrics> metrics;
+	boost::shared_ptr<std::atomic<unsigned>> waiting;
+
+	void operator()() const {
+		// The backend is detached, so no new wait starts; the ones in progress end once the
+		// function which stopped the reactor returns.
+		drain(*waiting);
+		backend->shutdown();
+		threads->join_all();
+		delete backend;
+	}
+};
+
+Reactor::Reactor() : backend(NULL), posting(0), waiting(new std::atomic<unsigned>(0)), closing(false),
+	threadCount(0), metrics(new ReactorMetrics()) {
+}
+
+Reactor::Dyn Reactor::create() {
+	return Dyn(new Reactor());
+}
+
+Reactor::~Reactor() {
+	stop();
+}
+
+void Reactor::open(unsigned count, Backend kind) {
+	if(count == 0)
+		throw Exception("A reactor needs at least one thread!", CodePos);
+	if(backend.load())
+		throw Exception("The reactor is already started!", CodePos);
+	ReactorBackend* fresh;
+	if(kind == WorkStealing)
+		fresh = new StealingReactorBackend(count, *metrics);
+	else
+		fresh = new AsioReactorBackend(count, *metrics);
+	// Two threads starting the reactor at once may both get here: only one backend is installed.
+	ReactorBackend* expected = NULL;
+	if(!backend.compare_exchange_strong(expected, fresh)) {
+		delete fresh;
+		throw Exception("The reactor is already started!", CodePos);
+	}
+	threadCount = count;
+}
+
+ReactorBackend* Reactor::detach() {
+	ReactorBackend* b = backend.exchange(NULL);
+	drain(posting);
+	return b;
+}
+
+void Reactor::drainWaits() {
+	closing.store(true);
+	drain(*waiting);
+}
+
+void Reactor::close() {
+	delete detach();
+	closing.store(false);
+}
+
+void Reactor::serve(ReactorBackend* backend) {
+	servedBackend = backend;
+	backend->run();
+	servedBackend = NULL;
+}
+
+bool Reactor::isOwnThread() const {
+	ReactorBackend* b = backend.load();
+	return b && servedBackend == b;
+}
+
+void Reactor::start(unsigned count, Backend kind) {
+	open(count, kind);
+	threads.reset(new boost::thread_group());
+	for(unsigned i = 0; i < count; ++i)
+		threads->create_thread(boost::bind(&Reactor::serve, backend.load()));
+}
+
+void Reactor::stop() {
+	ReactorBackend* b = backend.load();
+	if(!b)
+		return;
+	if(isOwnThread()) {
+		// The calling function is one the backend waits for, and its thread is one to join.
+		// Functions posted from now on are refused, the queued ones still run.
+		Reaper reaper = { detach(), threads, metrics, waiting };
+		threads.reset();
+		boost::thread(reaper).detach();
+		return;
+	}
+	drainWaits();
+	b->shutdown();
+	threads->join_all();
+	threads.reset();
+	close();
+}
+
+void Reactor::sync() {
+	// The calling function is one the wait would be for.
+	if(isOwnThread())
+		throw Exception("The reactor can not be waited for from its own thread!", CodePos);
+	Posting w(*waiting);
+	ReactorBackend* b = backend.load();
+	if(!b || closing.load())
+		throw Exception("The reactor is not started!", CodePos);
+	b->sync();
+}
+
+void Reactor::flush() {
+	// The calling function is one the wait would be for.
+	if(isOwnThread())
+		throw Exception("The reactor can not be waited for from its own thread!", CodePos);
+	Posting w(*waiting);
+	ReactorBackend* b = backend.load();
+	if(!b || closing.load())
+		throw Exception("The reactor is not started!", CodePos);
+	b->flush();
+}
+
+bool Reactor::tryPost(const boost::function<void()>& func, const void* key, Priority::Class priority,
+                      const void* source) {
+	Posting p(posting);
+	ReactorBackend* b = backend.load();
+	if(!b)
+		return false;
+	b->post(func, key, priority, source);
+	return true;
+}
+
+void Reactor::post(const boost::function<void()>& func, const void* key, Priority::Class priority) {
+	if(!tryPost(func, key, priority))
+		throw Exception("The reactor is not started!", CodePos);
+}
+
+bool Reactor::isStarted() const {
+	return backend.load() != NULL;
+}
+
+unsigned Reactor::getThreadCount() const {
+	return threadCount;
+}
+
+ReactorMetrics& Reactor::getMetrics() {
+	return *metrics;
+}
+
+}
+}
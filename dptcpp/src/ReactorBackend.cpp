@@ -0,0 +1,139 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/thread/locks.hpp>
+
+#include "dptcpp/ReactorBackend.h"
+#include "dptcpp/ReactorMetrics.h"
+
+namespace denprot {
+namespace config {
+
+const unsigned Priority::Count;
+const unsigned ReactorBackend::LanesPerThread;
+const unsigned ReactorBackend::LaneBatch;
+
+/**
+ * The ordering key of the markers queued by flush(). Markers are not callbacks of the user,
+ * so they are kept out of the metrics.
+ */
+static const char markerKey = 0;
+
+ReactorBackend::Finish::~Finish() {
+	if(task->key != &markerKey)
+		backend->metrics.finished(startedAt, task->key, task->source, priority);
+	if(task->completion)
+		task->completion->settle();
+	if(backend->outstanding.fetch_sub(1) == 1) {
+		boost::lock_guard<boost::mutex> lck(backend->drainLock);
+		backend->drained.notify_all();
+	}
+}
+
+/**
+ * The function queued by flush(), doing nothing.
+ */
+static void marker() {
+}
+
+ReactorBackend::ReactorBackend(unsigned threads, ReactorMetrics& metrics) : metrics(metrics),
+	laneCount(threads == 1 ? 1 : threads * LanesPerThread), lanes(new Lane[laneCount * Priority::Count]),
+	outstanding(0) {
+	for(unsigned p = 0; p < Priority::Count; ++p) {
+		waiting[p].store(0);
+		for(unsigned i = 0; i < laneCount; ++i)
+			lanes[p * laneCount + i].priority = static_cast<Priority::Class>(p);
+	}
+}
+
+ReactorBackend::Lane* ReactorBackend::push(Lane* lane, const boost::function<void()>& func, const void* key,
+                                           const void* source) {
+	outstanding.fetch_add(1);
+	ChangeTokenState* completion = ChangeTracker::current();
+	if(completion)
+		completion->hold();
+	bool recorded = key != &markerKey;
+	std::chrono::steady_clock::time_point postedAt;
+	if(recorded)
+		postedAt = metrics.enqueued();
+	try {
+		lane->funcs.push(func, key, postedAt, completion, source ? source : key);
+	} catch(...) {
+		if(recorded)
+			metrics.withdrawn();
+		if(completion)
+			completion->settle();
+		if(outstanding.fetch_sub(1) == 1) {
+			boost::lock_guard<boost::mutex> lck(drainLock);
+			drained.notify_all();
+		}
+		throw;
+	}
+	return lane->scheduled.exchange(true) ? NULL : lane;
+}
+
+void ReactorBackend::post(const boost::function<void()>& func, const void* key, Priority::Class priority,
+                          const void* source) {
+	Lane* lane = push(&lanes[priority * laneCount + indexOf(key, laneCount)], func, key, source);
+	if(lane)
+		schedule(lane);
+}
+
+void ReactorBackend::sync() {
+	boost::unique_lock<boost::mutex> lck(drainLock);
+	while(outstanding.load() != 0)
+		drained.wait(lck);
+}
+
+void ReactorBackend::flush() {
+	ChangeTracker tracker;
+	boost::function<void()> func(&marker);
+	for(unsigned i = 0; i < laneCount * Priority::Count; ++i) {
+		Lane* lane = push(&lanes[i], func, &markerKey, NULL);
+		if(lane)
+			schedule(lane);
+	}
+	tracker.close().wait();
+}
+
+bool ReactorBackend::runLane(Lane* lane) {
+	ReactorTask task;
+	for(unsigned n = 0; n < LaneBatch && lane->funcs.pop(task); ++n) {
+		{
+			Finish f = { this, &task, lane->priority,
+			  task.key == &markerKey ? std::chrono::steady_clock::time_point() : metrics.dequeued(task.posted) };
+			task.func();
+		}
+		task.func.clear();
+		bool preempted = false;
+		for(unsigned p = 0; p < lane->priority; ++p)
+			preempted = preempted || waiting[p].load(std::memory_order_relaxed) != 0;
+		if(preempted)
+			break;
+	}
+	if(!lane->funcs.empty())
+		return true;
+	// A poster finding the lane scheduled relies on this run to take its function: after the
+	// flag is cleared, either its push is seen here or it schedules the lane itself. Another
+	// thread may run the lane by then, so only the head of the queue is read.
+	const ReactorQueue::Node* consumed = lane->funcs.consumed();
+	lane->scheduled.store(false);
+	return lane->funcs.pushedAfter(consumed) && !lane->scheduled.exchange(true);
+}
+
+}
+}
@@ -0,0 +1,92 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures how asynchronous notification throughput scales with the number of reactor threads.
+ *
+ * Every property has one asynchronous subscriber which spins for a fixed time, standing in for real callback
+ * work. The properties are updated round-robin from the main thread, and the run ends when every posted
+ * notification has run. Throughput is reported for both reactor backends and each thread count.
+ *
+ * Build with "make check" and run ./ReactorBench [properties] [updates per property] [callback work in ns].
+ */
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "dptcpp/Property.h"
+#include "dptcpp/PropertyReactor.h"
+
+using namespace denprot::config;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+std::atomic<unsigned long> callbacks(0);
+
+void spin(std::chrono::nanoseconds work) {
+	Clock::time_point end = Clock::now() + work;
+	while(Clock::now() < end)
+		;
+	callbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void measure(const char* name, PropertyReactor::Backend kind, unsigned threads, unsigned properties,
+             unsigned updates, std::chrono::nanoseconds work) {
+	PropertyReactor::start(threads, kind);
+	std::vector<Property<int>> props;
+	for(unsigned i = 0; i < properties; ++i) {
+		props.push_back(Property<int>("p", 0));
+		props.back().connect(boost::function<void(Property<int>&)>([work](Property<int>&) { spin(work); }));
+	}
+	callbacks = 0;
+
+	Clock::time_point start = Clock::now();
+	for(unsigned n = 1; n <= updates; ++n)
+		for(unsigned i = 0; i < properties; ++i)
+			props[i] = static_cast<int>(n);
+	PropertyReactor::sync();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	PropertyReactor::stop();
+
+	std::cout << name << " threads " << threads << ": " << static_cast<unsigned long>(callbacks / seconds)
+	          << " callbacks/s, " << static_cast<unsigned long>(properties * updates / seconds) << " updates/s"
+	          << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+	unsigned properties = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 64;
+	unsigned updates = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 200;
+	std::chrono::nanoseconds work(argc > 3 ? std::strtoul(argv[3], NULL, 10) : 2000);
+	unsigned cores = boost::thread::hardware_concurrency();
+
+	std::cout << properties << " properties, " << updates << " updates each, " << work.count()
+	          << " ns per callback, " << cores << " hardware threads" << std::endl;
+	for(unsigned threads = 1; threads <= 8; threads *= 2) {
+		measure("asio    ", PropertyReactor::Asio, threads, properties, updates, work);
+		measure("stealing", PropertyReactor::WorkStealing, threads, properties, updates, work);
+	}
+	return 0;
+}
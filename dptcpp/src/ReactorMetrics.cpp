@@ -0,0 +1,192 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/thread/locks.hpp>
+#include <algorithm>
+
+#include "dptcpp/ReactorMetrics.h"
+
+namespace denprot {
+namespace config {
+
+const unsigned ReactorMetrics::Buckets;
+
+/**
+ * The bucket of a duration: the number of its significant bits in nanoseconds.
+ */
+static unsigned bucketOf(unsigned long long ns) {
+	unsigned bucket = 0;
+	for(; ns != 0 && bucket < ReactorMetrics::Buckets - 1; ns >>= 1)
+		++bucket;
+	return bucket;
+}
+
+ReactorMetrics::Histogram::Histogram() : count(0), total(0), max(0) {
+	for(unsigned i = 0; i < Buckets; ++i)
+		counts[i] = 0;
+}
+
+std::chrono::nanoseconds ReactorMetrics::Histogram::upperBound(unsigned bucket) {
+	return std::chrono::nanoseconds(1LL << bucket);
+}
+
+std::chrono::nanoseconds ReactorMetrics::Histogram::mean() const {
+	if(count == 0)
+		return std::chrono::nanoseconds(0);
+	return std::chrono::nanoseconds(total.count() / static_cast<long long>(count));
+}
+
+std::chrono::nanoseconds ReactorMetrics::Histogram::percentile(double fraction) const {
+	if(count == 0)
+		return std::chrono::nanoseconds(0);
+	unsigned long rank = static_cast<unsigned long>(fraction * count);
+	unsigned long seen = 0;
+	for(unsigned i = 0; i < Buckets - 1; ++i) {
+		seen += counts[i];
+		if(seen > rank)
+			return std::min(upperBound(i), max);
+	}
+	return max;
+}
+
+ReactorMetrics::Counters::Counters() {
+	reset();
+}
+
+void ReactorMetrics::Counters::record(std::chrono::nanoseconds duration) {
+	unsigned long long ns = duration.count() < 0 ? 0 : duration.count();
+	counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+	total.fetch_add(ns, std::memory_order_relaxed);
+	unsigned long long top = max.load(std::memory_order_relaxed);
+	while(ns > top && !max.compare_exchange_weak(top, ns, std::memory_order_relaxed))
+		;
+}
+
+void ReactorMetrics::Counters::read(Histogram& histogram) const {
+	histogram.count = 0;
+	for(unsigned i = 0; i < Buckets; ++i) {
+		histogram.counts[i] = counts[i].load(std::memory_order_relaxed);
+		histogram.count += histogram.counts[i];
+	}
+	histogram.total = std::chrono::nanoseconds(total.load(std::memory_order_relaxed));
+	histogram.max = std::chrono::nanoseconds(max.load(std::memory_order_relaxed));
+}
+
+void ReactorMetrics::Counters::reset() {
+	for(unsigned i = 0; i < Buckets; ++i)
+		counts[i].store(0, std::memory_order_relaxed);
+	total.store(0, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+}
+
+void ReactorMetrics::Snapshot::dump(std::ostream& out) const {
+	out << "queued " << queued << '\n'
+	    << "peak_queued " << peakQueued << '\n'
+	    << "posted " << posted << '\n'
+	    << "completed " << completed << '\n'
+	    << "slow " << slow << '\n';
+	const char* names[] = { "dispatch", "execution" };
+	const Histogram* histograms[] = { &dispatch, &execution };
+	for(unsigned h = 0; h < 2; ++h) {
+		const Histogram& hist = *histograms[h];
+		out << names[h] << "_count " << hist.count << '\n'
+		    << names[h] << "_mean " << hist.mean().count() << '\n'
+		    << names[h] << "_p50 " << hist.percentile(0.5).count() << '\n'
+		    << names[h] << "_p99 " << hist.percentile(0.99).count() << '\n'
+		    << names[h] << "_max " << hist.max.count() << '\n';
+		for(unsigned i = 0; i < Buckets; ++i) {
+			if(hist.counts[i] != 0)
+				out << names[h] << "_bucket " << Histogram::upperBound(i).count() << ' ' << hist.counts[i] << '\n';
+		}
+	}
+}
+
+ReactorMetrics::ReactorMetrics() : posted(0), started(0), peakQueued(0), completed(0), slow(0), postedBase(0),
+	timed(false), slowThreshold(0) {
+}
+
+ReactorMetrics::Snapshot ReactorMetrics::snapshot() const {
+	Snapshot s;
+	unsigned long start = started.load(std::memory_order_relaxed);
+	unsigned long count = posted.load(std::memory_order_relaxed);
+	s.queued = static_cast<long>(count - start);
+	s.posted = count - postedBase.load(std::memory_order_relaxed);
+	s.peakQueued = std::max(peakQueued.load(std::memory_order_relaxed), s.queued);
+	s.completed = completed.load(std::memory_order_relaxed);
+	s.slow = slow.load(std::memory_order_relaxed);
+	dispatch.read(s.dispatch);
+	execution.read(s.execution);
+	return s;
+}
+
+void ReactorMetrics::reset() {
+	unsigned long start = started.load(std::memory_order_relaxed);
+	unsigned long count = posted.load(std::memory_order_relaxed);
+	postedBase.store(count, std::memory_order_relaxed);
+	peakQueued.store(static_cast<long>(count - start), std::memory_order_relaxed);
+	completed.store(0, std::memory_order_relaxed);
+	slow.store(0, std::memory_order_relaxed);
+	dispatch.reset();
+	execution.reset();
+}
+
+void ReactorMetrics::setTimed(bool on) {
+	timed.store(on, std::memory_order_relaxed);
+}
+
+void ReactorMetrics::setSlowThreshold(std::chrono::nanoseconds threshold,
+                                      const boost::function<void(const SlowCallback&)>& handler) {
+	boost::lock_guard<boost::mutex> lck(handlerLock);
+	slowHandler = handler;
+	slowThreshold.store(threshold.count() < 0 ? 0 : threshold.count(), std::memory_order_relaxed);
+	if(threshold.count() > 0)
+		timed.store(true, std::memory_order_relaxed);
+}
+
+void ReactorMetrics::raisePeak(long depth) {
+	long peak = peakQueued.load(std::memory_order_relaxed);
+	while(depth > peak && !peakQueued.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+		;
+}
+
+std::chrono::steady_clock::time_point ReactorMetrics::timeDispatch(std::chrono::steady_clock::time_point postedAt) {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	dispatch.record(now - postedAt);
+	return now;
+}
+
+void ReactorMetrics::timeExecution(std::chrono::steady_clock::time_point startedAt, const void* key,
+                                   const void* source, Priority::Class priority) {
+	std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - startedAt;
+	execution.record(duration);
+	long long threshold = slowThreshold.load(std::memory_order_relaxed);
+	if(threshold == 0 || duration.count() <= threshold)
+		return;
+	slow.fetch_add(1, std::memory_order_relaxed);
+	boost::function<void(const SlowCallback&)> handler;
+	{
+		boost::lock_guard<boost::mutex> lck(handlerLock);
+		handler = slowHandler;
+	}
+	if(handler) {
+		SlowCallback report = { key, source, priority, duration };
+		handler(report);
+	}
+}
+
+}
+}
@@ -0,0 +1,161 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dptcpp/ReactorQueue.h"
+
+namespace denprot {
+namespace config {
+
+const unsigned ReactorQueue::CacheSize;
+
+/**
+ * The number of nodes allocated at once when a thread finds no free node.
+ */
+static const unsigned NodeBlock = 64;
+
+/**
+ * The free nodes returned by the threads, linked through their next pointers. Nodes are
+ * pushed one chain at a time and always taken all at once, so the list is immune to ABA.
+ */
+static std::atomic<ReactorQueue::Node*> sharedNodes(NULL);
+
+/**
+ * The free nodes of a thread, given back to sharedNodes when the thread exits.
+ */
+struct NodeCache {
+	ReactorQueue::Node* first;
+	ReactorQueue::Node* last;
+	unsigned count;
+
+	NodeCache() : first(NULL), last(NULL), count(0) {
+	}
+
+	/**
+	 * Hands every cached node to sharedNodes.
+	 */
+	void spill() {
+		if(!first)
+			return;
+		ReactorQueue::Node* top = sharedNodes.load(std::memory_order_relaxed);
+		do {
+			last->next.store(top, std::memory_order_relaxed);
+		} while(!sharedNodes.compare_exchange_weak(top, first, std::memory_order_release, std::memory_order_relaxed));
+		first = last = NULL;
+		count = 0;
+	}
+
+	/**
+	 * Takes every node of sharedNodes.
+	 */
+	void refill() {
+		first = last = sharedNodes.exchange(NULL, std::memory_order_acquire);
+		count = 0;
+		if(!first)
+			return;
+		for(count = 1; ReactorQueue::Node* next = last->next.load(std::memory_order_relaxed); ++count)
+			last = next;
+	}
+
+	~NodeCache() {
+		spill();
+	}
+};
+
+static thread_local NodeCache nodeCache;
+
+ReactorQueue::Node* ReactorQueue::allocate() {
+	NodeCache& cache = nodeCache;
+	if(!cache.first)
+		cache.refill();
+	if(!cache.first) {
+		// The pool never shrinks, so nodes are carved out of blocks which are never freed.
+		Node* block = new Node[NodeBlock];
+		for(unsigned i = 1; i < NodeBlock; ++i)
+			block[i].next.store(i + 1 < NodeBlock ? &block[i + 1] : NULL, std::memory_order_relaxed);
+		cache.first = &block[1];
+		cache.last = &block[NodeBlock - 1];
+		cache.count = NodeBlock - 1;
+		return block;
+	}
+	Node* node = cache.first;
+	cache.first = node->next.load(std::memory_order_relaxed);
+	if(!cache.first)
+		cache.last = NULL;
+	--cache.count;
+	return node;
+}
+
+void ReactorQueue::release(Node* node) {
+	NodeCache& cache = nodeCache;
+	node->next.store(cache.first, std::memory_order_relaxed);
+	cache.first = node;
+	if(!cache.last)
+		cache.last = node;
+	if(++cache.count >= CacheSize)
+		cache.spill();
+}
+
+ReactorQueue::ReactorQueue() : head(allocate()) {
+	tail = head.load();
+	tail->next.store(NULL);
+}
+
+ReactorQueue::~ReactorQueue() {
+	ReactorTask task;
+	while(pop(task)) {
+		task.func.clear();
+		if(task.completion)
+			task.completion->settle();
+	}
+	release(tail);
+}
+
+void ReactorQueue::push(const boost::function<void()>& func, const void* key,
+                        std::chrono::steady_clock::time_point posted, ChangeTokenState* completion,
+                        const void* source) {
+	Node* node = allocate();
+	try {
+		node->task.func = func;
+	} catch(...) {
+		release(node);
+		throw;
+	}
+	node->task.key = key;
+	node->task.source = source;
+	node->task.posted = posted;
+	node->task.completion = completion;
+	node->next.store(NULL, std::memory_order_relaxed);
+	Node* prev = head.exchange(node);
+	prev->next.store(node, std::memory_order_release);
+}
+
+bool ReactorQueue::pop(ReactorTask& task) {
+	Node* next = tail->next.load(std::memory_order_acquire);
+	if(!next)
+		return false;
+	task.func.swap(next->task.func);
+	task.key = next->task.key;
+	task.source = next->task.source;
+	task.posted = next->task.posted;
+	task.completion = next->task.completion;
+	release(tail);
+	tail = next;
+	return true;
+}
+
+}
+}
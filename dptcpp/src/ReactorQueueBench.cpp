@@ -0,0 +1,154 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures the cost of queueing functions for the reactor and the throughput of draining them.
+ *
+ * The first part compares ReactorQueue with an io_service::strand and a mutex guarded deque: producer threads
+ * enqueue no-op functions, then a single consumer runs all of them. The second part posts notifications of an
+ * asynchronous subscriber while the reactor is blocked, then times how fast the reactor catches up.
+ *
+ * Build with "make check" and run ./ReactorQueueBench [functions].
+ */
+
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+
+#include "dptcpp/Property.h"
+#include "dptcpp/PropertyReactor.h"
+#include "dptcpp/ReactorQueue.h"
+
+using namespace denprot::config;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double perOp(Clock::time_point start, Clock::time_point end, unsigned long ops) {
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+volatile unsigned long sink;
+
+void noop() {
+	sink = sink + 1;
+}
+
+template<class Push, class Drain>
+void measureQueue(const char* name, unsigned producers, unsigned long n, Push push, Drain drain) {
+	Clock::time_point start = Clock::now();
+	boost::thread_group group;
+	for(unsigned p = 0; p < producers; ++p)
+		group.create_thread([&]() {
+			for(unsigned long i = 0; i < n / producers; ++i)
+				push();
+		});
+	group.join_all();
+	Clock::time_point enqueued = Clock::now();
+	drain();
+	Clock::time_point drained = Clock::now();
+	std::cout << name << " producers " << producers << ": enqueue " << perOp(start, enqueued, n) << " ns, drain "
+	          << perOp(enqueued, drained, n) << " ns" << std::endl;
+}
+
+void measureQueues(unsigned producers, unsigned long n) {
+	boost::function<void()> func(&noop);
+	{
+		boost::asio::io_service service;
+		boost::asio::io_service::strand strand(service);
+		measureQueue("strand::post", producers, n, [&]() { strand.post(&noop); }, [&]() { service.run(); });
+	}
+	{
+		boost::mutex mutex;
+		std::deque<boost::function<void()>> queue;
+		measureQueue("mutex+deque ", producers, n, [&]() {
+			boost::lock_guard<boost::mutex> lock(mutex);
+			queue.push_back(func);
+		}, [&]() {
+			for(;;) {
+				boost::function<void()> next;
+				{
+					boost::lock_guard<boost::mutex> lock(mutex);
+					if(queue.empty())
+						break;
+					next.swap(queue.front());
+					queue.pop_front();
+				}
+				next();
+			}
+		});
+	}
+	{
+		ReactorQueue queue;
+		measureQueue("ReactorQueue", producers, n, [&]() { queue.push(func); }, [&]() {
+			ReactorTask task;
+			while(queue.pop(task))
+				task.func();
+		});
+	}
+}
+
+void measureReactor(unsigned long n) {
+	PropertyReactor::start();
+	Property<int> prop("p", 0);
+	std::atomic<unsigned long> seen(0);
+	prop.connect(boost::function<void(Property<int>&)>([&](Property<int>&) {
+		seen.fetch_add(1, std::memory_order_relaxed);
+	}));
+
+	// The first round fills the node pool, the second one shows the steady state.
+	for(unsigned round = 0; round < 2; ++round) {
+		std::atomic<bool> blocked(true);
+		seen = 0;
+		PropertyReactor::post([&]() {
+			while(blocked.load())
+				boost::this_thread::yield();
+		});
+
+		Clock::time_point start = Clock::now();
+		for(unsigned long i = 0; i < n; ++i)
+			prop.forceChange();
+		Clock::time_point posted = Clock::now();
+
+		blocked = false;
+		while(seen.load() < n)
+			boost::this_thread::yield();
+		Clock::time_point drained = Clock::now();
+		std::cout << "reactor round " << round << ": post " << perOp(start, posted, n) << " ns, drain "
+		          << perOp(posted, drained, n) << " ns" << std::endl;
+	}
+	PropertyReactor::stop();
+}
+
+}
+
+int main(int argc, char** argv) {
+	unsigned long n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 2000000;
+
+	measureQueues(1, n);
+	measureQueues(4, n);
+	measureReactor(n / 4);
+	return 0;
+}
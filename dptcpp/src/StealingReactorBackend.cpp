@@ -0,0 +1,102 @@
+/*
+ * This file is part of dptcpp.
+ *
+ *  dptcpp is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dptcpp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dptcpp.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dptcpp/StealingReactorBackend.h"
+
+namespace denprot {
+namespace config {
+
+/**
+ * The backend the current thread runs for, if any.
+ */
+static thread_local const StealingReactorBackend* currentBackend = NULL;
+
+/**
+ * The deque of the current thread in currentBackend.
+ */
+static thread_local unsigned currentWorker = 0;
+
+StealingReactorBackend::StealingReactorBackend(unsigned threads, ReactorMetrics& metrics) : ReactorBackend(threads, metrics),
+	workerCount(threads), workers(new Worker[threads]), registered(0), nextWorker(0),
+	tasks(0), sleeping(0), quit(false) {
+}
+
+void StealingReactorBackend::schedule(Lane* lane) {
+	unsigned w = currentBackend == this ? currentWorker :
+	  nextWorker.fetch_add(1, std::memory_order_relaxed) % workerCount;
+	{
+		boost::lock_guard<boost::mutex> lck(workers[w].lock);
+		workers[w].tasks[lane->priority].push_back(lane);
+		queued(lane->priority);
+	}
+	tasks.fetch_add(1);
+	if(sleeping.load() != 0) {
+		boost::lock_guard<boost::mutex> lck(idleLock);
+		idle.notify_one();
+	}
+}
+
+StealingReactorBackend::Lane* StealingReactorBackend::take(unsigned self) {
+	for(unsigned p = 0; p < Priority::Count; ++p) {
+		if(waiting[p].load() == 0)
+			continue;
+		for(unsigned i = 0; i < workerCount; ++i) {
+			Worker& w = workers[(self + i) % workerCount];
+			boost::lock_guard<boost::mutex> lck(w.lock);
+			if(!w.tasks[p].empty()) {
+				Lane* lane = w.tasks[p].front();
+				w.tasks[p].pop_front();
+				dequeued(lane->priority);
+				tasks.fetch_sub(1);
+				return lane;
+			}
+		}
+	}
+	return NULL;
+}
+
+void StealingReactorBackend::run() {
+	unsigned self = registered.fetch_add(1) % workerCount;
+	currentBackend = this;
+	currentWorker = self;
+	while(true) {
+		Lane* lane = take(self);
+		if(lane) {
+			if(runLane(lane))
+				schedule(lane);
+			continue;
+		}
+		boost::unique_lock<boost::mutex> lck(idleLock);
+		sleeping.fetch_add(1);
+		while(tasks.load() == 0 && !quit.load())
+			idle.wait(lck);
+		sleeping.fetch_sub(1);
+		if(tasks.load() == 0 && quit.load())
+			break;
+	}
+	currentBackend = NULL;
+}
+
+void StealingReactorBackend::shutdown() {
+	sync();
+	boost::lock_guard<boost::mutex> lck(idleLock);
+	quit.store(true);
+	idle.notify_all();
+}
+
+}
+}